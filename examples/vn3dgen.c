@@ -1,25 +1,358 @@
 #include <vn3d.h>
 #include <turbojpeg.h>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 
 #include <time.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
 #define N 256
 
+/*
+ * Shard file is a header padded to SHARD_DATA_OFFSET bytes followed by
+ * 32-bit noise values of the shard in the order of vn_render_3d(). The
+ * padding keeps the data page aligned for copy_file_range() and mmap().
+ */
+#define SHARD_MAGIC "VN3DSHRD"
+#define SHARD_DATA_OFFSET 4096
+
+struct shard_header {
+    char magic[8];
+    char desc[VN_DESC_MAXLEN];
+    struct vn_region volume;
+    struct vn_region shard;
+};
+
 static void usage()
 {
     fprintf (stderr, "Usage:\n");
     fprintf (stderr, "vn3dgen output width height value <octaves> <grid_size>\n");
     fprintf (stderr, "vn3dgen output width height worley <dots> <grid_size>\n");
+    fprintf (stderr, "vn3dgen shard output width height depth index nshards descriptor [threads]\n");
+    fprintf (stderr, "vn3dgen merge output shard...\n");
+    fprintf (stderr, "Descriptor is type:param:grid_size:seed, e.g. value:5:8:1234\n");
 
     exit(1);
 }
 
+static int write_all (int fd, const void *data, size_t size, off_t offset)
+{
+    const char *ptr = data;
+    ssize_t written;
+
+    while (size != 0) {
+        written = pwrite (fd, ptr, size, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        ptr += written;
+        offset += written;
+        size -= written;
+    }
+
+    return 1;
+}
+
+static int shard_main (int argc, char *argv[])
+{
+    struct vn_generator_desc desc;
+    struct vn_generator *gen = NULL;
+    struct vn_render_options options = {0, NULL, 0, NULL};
+    struct vn_numa_stats numa;
+    struct vn_region volume = {0, 0, 0, 0, 0, 0};
+    struct shard_header header;
+    unsigned int *buffer = NULL;
+    size_t size;
+    int index, nshards, threads = 1;
+    unsigned int i;
+    int fd, res = 1;
+
+    if (argc != 8 && argc != 9) usage();
+
+    volume.width = strtol (argv[2], NULL, 10);
+    volume.height = strtol (argv[3], NULL, 10);
+    volume.depth = strtol (argv[4], NULL, 10);
+    index = strtol (argv[5], NULL, 10);
+    nshards = strtol (argv[6], NULL, 10);
+    if (argc == 9) threads = strtol (argv[8], NULL, 10);
+    if (volume.width == 0 || volume.height == 0 || volume.depth == 0 ||
+        nshards <= 0 || index < 0 || index >= nshards || threads <= 0) usage();
+
+    if (!vn_desc_parse (argv[7], &desc)) {
+        fprintf (stderr, "%s: %s\n", vn_get_error_msg(), argv[7]);
+        return 1;
+    }
+
+    gen = vn_generator_from_desc (&desc);
+    if (gen == NULL) {
+        fprintf (stderr, "Cannot create generator: %s\n", vn_get_error_msg());
+        return 1;
+    }
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, SHARD_MAGIC, sizeof (header.magic));
+    vn_desc_format (&desc, header.desc, sizeof (header.desc));
+    header.volume = volume;
+    if (!vn_shard_region (&volume, nshards, index, &header.shard)) {
+        fprintf (stderr, "Cannot make shard: %s\n", vn_get_error_msg());
+        goto cleanup;
+    }
+
+    /* There are more shards than z planes, this one has only a header */
+    size = (size_t)header.shard.width * header.shard.height *
+        header.shard.depth * sizeof (unsigned int);
+    if (size != 0) {
+        buffer = vn_alloc_output (size, VN_ALLOC_HUGE_PAGES);
+        if (buffer == NULL) {
+            fprintf (stderr, "Cannot allocate memory\n");
+            goto cleanup;
+        }
+
+        options.threads = threads;
+        options.flags = (threads > 1)? VN_RENDER_PIN_NUMA | VN_RENDER_FIRST_TOUCH: 0;
+        options.numa_stats = &numa;
+        if (!vn_render_3d_ex (gen, &header.shard, buffer, &options)) {
+            fprintf (stderr, "Cannot render shard: %s\n", vn_get_error_msg());
+            goto cleanup;
+        }
+
+        for (i=0; i<numa.nodes; i++) {
+            if (numa.threads[i] == 0) continue;
+            printf ("Node %u: %u threads, %.1f MB/s\n", i, numa.threads[i],
+                    vn_numa_throughput (&numa, i) / 1e6);
+        }
+    }
+
+    fd = open (argv[1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        perror ("Cannot open file");
+        goto cleanup;
+    }
+
+    if (!write_all (fd, &header, sizeof (header), 0) ||
+        !write_all (fd, buffer, size, SHARD_DATA_OFFSET)) {
+        perror ("Cannot write shard");
+        close (fd);
+        goto cleanup;
+    }
+    close (fd);
+    res = 0;
+
+cleanup:
+    vn_destroy_generator (gen);
+    if (buffer != NULL) vn_free_output (buffer, size);
+
+    return res;
+}
+
+/* Copy a range of bytes between files without passing it through user space if possible */
+static int copy_range (int in, off_t in_offset, int out, off_t out_offset, size_t size)
+{
+    /* Empty shards have no data, and mmap() fails for zero length */
+    if (size == 0) return 1;
+
+#ifdef HAVE_COPY_FILE_RANGE
+    while (size != 0) {
+        ssize_t copied = copy_file_range (in, &in_offset, out, &out_offset, size, 0);
+        if (copied < 0) {
+            if (errno == EINTR) continue;
+            /* Not supported for these files, try mmap */
+            if (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)
+                break;
+            return 0;
+        }
+        if (copied == 0) return 0;
+        size -= copied;
+    }
+    if (size == 0) return 1;
+#endif
+
+    long page = sysconf (_SC_PAGESIZE);
+    off_t aligned = in_offset - in_offset % page;
+    size_t skip = in_offset - aligned;
+    char *data = mmap (NULL, size + skip, PROT_READ, MAP_SHARED, in, aligned);
+    int res;
+
+    if (data == MAP_FAILED) return 0;
+    res = write_all (out, data + skip, size, out_offset);
+    munmap (data, size + skip);
+
+    return res;
+}
+
+/* Check that the box `inner` lies in the box `outer` along one axis */
+static int inside (unsigned int inner, unsigned int inner_size,
+                   unsigned int outer, unsigned int outer_size)
+{
+    return inner >= outer && inner - outer <= outer_size &&
+        inner_size <= outer_size - (inner - outer);
+}
+
+static int open_shard (const char *path, struct shard_header *header)
+{
+    int in = open (path, O_RDONLY);
+
+    if (in == -1) {
+        perror ("Cannot open shard");
+        return -1;
+    }
+
+    if (pread (in, header, sizeof (*header), 0) != sizeof (*header) ||
+        memcmp (header->magic, SHARD_MAGIC, sizeof (header->magic)) != 0) {
+        fprintf (stderr, "%s is not a shard\n", path);
+        close (in);
+        return -1;
+    }
+
+    return in;
+}
+
+static int merge_main (int argc, char *argv[])
+{
+    struct shard_header header, first;
+    struct vn_region *volume = &first.volume, *shard = &header.shard;
+    struct vn_region *shards = NULL;
+    struct stat st;
+    unsigned char *covered = NULL;
+    char magic[sizeof (header.magic)];
+    size_t size = 0, plane = 0;
+    int i, in = -1, out = -1, created = 0;
+    unsigned int k;
+
+    if (argc < 3) usage();
+
+    shards = malloc ((argc - 2) * sizeof (struct vn_region));
+    if (shards == NULL) {
+        fprintf (stderr, "Cannot allocate memory\n");
+        return 1;
+    }
+
+    /* Check that the shards make a whole volume before touching the output */
+    for (i=2; i<argc; i++) {
+        in = open_shard (argv[i], &header);
+        if (in == -1) goto fail;
+
+        if (i == 2) {
+            first = header;
+            plane = (size_t)volume->width * volume->height;
+            if (plane == 0 || volume->depth == 0 ||
+                plane > SIZE_MAX / sizeof (unsigned int) / volume->depth) {
+                fprintf (stderr, "%s has a bad volume size\n", argv[i]);
+                goto fail;
+            }
+            size = plane * volume->depth * sizeof (unsigned int);
+            covered = calloc (volume->depth, 1);
+            if (covered == NULL) {
+                fprintf (stderr, "Cannot allocate memory\n");
+                goto fail;
+            }
+        } else if (memcmp (&header.volume, volume, sizeof (struct vn_region)) != 0 ||
+                   strncmp (header.desc, first.desc, VN_DESC_MAXLEN) != 0) {
+            fprintf (stderr, "%s belongs to another volume\n", argv[i]);
+            goto fail;
+        }
+
+        /* Shards made by vn_shard_region() are slabs of whole z planes */
+        if (shard->x != volume->x || shard->width != volume->width ||
+            shard->y != volume->y || shard->height != volume->height ||
+            !inside (shard->z, shard->depth, volume->z, volume->depth)) {
+            fprintf (stderr, "%s is not a slab of the volume\n", argv[i]);
+            goto fail;
+        }
+
+        if (fstat (in, &st) == -1) {
+            perror ("Cannot stat shard");
+            goto fail;
+        }
+        if (shard->depth != 0 &&
+            (size_t)st.st_size < SHARD_DATA_OFFSET + plane * shard->depth * sizeof (unsigned int)) {
+            fprintf (stderr, "%s is truncated\n", argv[i]);
+            goto fail;
+        }
+
+        for (k=0; k<shard->depth; k++) {
+            unsigned int z = shard->z - volume->z + k;
+            if (covered[z]) {
+                fprintf (stderr, "%s overlaps another shard at plane %u\n", argv[i], z);
+                goto fail;
+            }
+            covered[z] = 1;
+        }
+
+        shards[i-2] = *shard;
+        close (in);
+        in = -1;
+    }
+
+    for (k=0; k<volume->depth; k++) {
+        if (!covered[k]) {
+            fprintf (stderr, "Plane %u of the volume is not in any shard\n", k);
+            goto fail;
+        }
+    }
+
+    /* Never overwrite a shard, e.g. when the output is omitted by mistake */
+    out = open (argv[1], O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (out != -1) created = 1;
+    else if (errno == EEXIST) {
+        out = open (argv[1], O_RDWR);
+        if (out != -1 && pread (out, magic, sizeof (magic), 0) == sizeof (magic) &&
+            memcmp (magic, SHARD_MAGIC, sizeof (magic)) == 0) {
+            fprintf (stderr, "%s is a shard, refusing to overwrite it\n", argv[1]);
+            goto fail;
+        }
+    }
+    if (out == -1) {
+        perror ("Cannot open output file");
+        goto fail;
+    }
+
+    if (ftruncate (out, 0) == -1 || ftruncate (out, size) == -1) {
+        perror ("Cannot resize output file");
+        goto fail;
+    }
+
+    for (i=2; i<argc; i++) {
+        in = open_shard (argv[i], &header);
+        if (in == -1) goto fail;
+
+        /* The shard is a contiguous part of the volume */
+        errno = 0;
+        if (!copy_range (in, SHARD_DATA_OFFSET, out,
+                         vn_shard_offset (volume, &shards[i-2]) * sizeof (unsigned int),
+                         plane * shards[i-2].depth * sizeof (unsigned int))) {
+            fprintf (stderr, "Cannot copy %s: %s\n", argv[i],
+                     (errno != 0)? strerror (errno): "unexpected end of file");
+            goto fail;
+        }
+
+        close (in);
+        in = -1;
+    }
+
+    free (shards);
+    free (covered);
+    close (out);
+    return 0;
+
+fail:
+    if (in != -1) close (in);
+    if (out != -1) close (out);
+    /* Do not leave a volume with holes, but only remove our own file */
+    if (created) unlink (argv[1]);
+    free (shards);
+    free (covered);
+    return 1;
+}
+
 int main (int argc, char *argv[])
 {
     struct vn_generator *gen = NULL;
@@ -31,6 +364,8 @@ int main (int argc, char *argv[])
     int fd;
     int width, height;
 
+    if (argc > 1 && strcmp (argv[1], "shard") == 0) return shard_main (argc - 1, argv + 1);
+    if (argc > 1 && strcmp (argv[1], "merge") == 0) return merge_main (argc - 1, argv + 1);
     if (argc < 5) usage ();
 
     width = strtol (argv[2], NULL, 10);
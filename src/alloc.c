@@ -0,0 +1,75 @@
+#include <sys/mman.h>
+#include <pthread.h>
+#include <stdio.h>
+#include "alloc.h"
+#include "generic.h"
+
+/*
+ * All mappings are rounded up to the default huge page size, so
+ * vn_free_output() does not need to know the flags and munmap() gets a
+ * length aligned for MAP_HUGETLB mappings too. Untouched pages cost
+ * nothing. The size is 2 MiB on amd64, but can be 1 GiB or 512 MiB (arm64
+ * with 64K pages), so it is read from /proc/meminfo where possible.
+ */
+#define DEFAULT_HUGE_PAGE_SIZE (2UL << 20)
+
+static size_t huge_page_size = DEFAULT_HUGE_PAGE_SIZE;
+static pthread_once_t huge_page_once = PTHREAD_ONCE_INIT;
+
+static void read_huge_page_size (void)
+{
+    FILE *file = fopen ("/proc/meminfo", "r");
+    char line[128];
+    unsigned long kb;
+
+    if (file == NULL) return;
+    while (fgets (line, sizeof (line), file) != NULL) {
+        if (sscanf (line, "Hugepagesize: %lu kB", &kb) == 1) {
+            /* Must be a power of two for round_size() */
+            if (kb != 0 && (kb & (kb - 1)) == 0)
+                huge_page_size = kb << 10;
+            break;
+        }
+    }
+    fclose (file);
+}
+
+static size_t round_size (size_t size)
+{
+    pthread_once (&huge_page_once, read_huge_page_size);
+    return (size + huge_page_size - 1) & ~(huge_page_size - 1);
+}
+
+void* vn_alloc_output (size_t size, unsigned int flags)
+{
+    void *memory = MAP_FAILED;
+    size_t rounded = round_size (size);
+
+#ifdef MAP_HUGETLB
+    if (flags & VN_ALLOC_HUGETLB)
+        memory = mmap (NULL, rounded, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+    if (memory == MAP_FAILED) {
+        memory = mmap (NULL, rounded, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            vn_errcode = NO_MEMORY;
+            return NULL;
+        }
+
+#ifdef MADV_HUGEPAGE
+        if (flags & (VN_ALLOC_HUGE_PAGES | VN_ALLOC_HUGETLB))
+            madvise (memory, rounded, MADV_HUGEPAGE);
+#endif
+    }
+
+    vn_errcode = ALL_OK;
+    return memory;
+}
+
+void vn_free_output (void *memory, size_t size)
+{
+    munmap (memory, round_size (size));
+}
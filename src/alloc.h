@@ -0,0 +1,48 @@
+/**
+   @file alloc.h
+   @brief Allocation of memory for big outputs.
+**/
+
+#ifndef __ALLOC_H__
+#define __ALLOC_H__
+
+#include <stddef.h>
+
+/**
+   \brief Back the memory with transparent huge pages if possible.
+**/
+#define VN_ALLOC_HUGE_PAGES 1
+
+/**
+   \brief Back the memory with explicitly reserved huge pages
+   (`MAP_HUGETLB` on Linux). If there are not enough reserved huge
+   pages, transparent huge pages are used instead.
+**/
+#define VN_ALLOC_HUGETLB 2
+
+/**
+   \brief Allocate memory for output of `vn_render_*()` functions.
+
+   The memory is mapped, but not touched, so physical pages are
+   allocated on the NUMA node of the thread which writes to them
+   first. When rendering with `vn_render_3d_ex()` with multiple
+   threads, each page is first written by the thread which renders
+   it. The mapping is rounded up to the default huge page size of the
+   system (`Hugepagesize` in `/proc/meminfo` on Linux). Affects the
+   error code.
+
+   \param size Size in bytes.
+   \param flags Zero or a combination of `VN_ALLOC_HUGE_PAGES` and
+          `VN_ALLOC_HUGETLB`.
+   \return Allocated memory or `NULL` on error.
+**/
+void* vn_alloc_output (size_t size, unsigned int flags);
+
+/**
+   \brief Free memory allocated by `vn_alloc_output()`.
+
+   `size` must be the same as passed to `vn_alloc_output()`.
+**/
+void vn_free_output (void *memory, size_t size);
+
+#endif
@@ -0,0 +1,58 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "private.h"
+
+/* Alignment of allocations in an arena */
+#define ARENA_ALIGN 64
+
+static pthread_key_t arena_key;
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+
+static void destroy_arena (void *arg)
+{
+    struct vn_arena *arena = arg;
+
+    free (arena->memory);
+    free (arena);
+}
+
+static void make_arena_key (void)
+{
+    pthread_key_create (&arena_key, destroy_arena);
+}
+
+struct vn_arena* vn_thread_arena (void)
+{
+    struct vn_arena *arena;
+
+    pthread_once (&arena_once, make_arena_key);
+    arena = pthread_getspecific (arena_key);
+    if (arena == NULL) {
+        arena = calloc (1, sizeof (struct vn_arena));
+        if (arena == NULL) return NULL;
+        pthread_setspecific (arena_key, arena);
+    }
+
+    return arena;
+}
+
+int vn_arena_reserve (struct vn_arena *arena, size_t size)
+{
+    arena->used = 0;
+
+    if (arena->capacity < size) {
+        free (arena->memory);
+        arena->memory = malloc (size);
+        arena->capacity = (arena->memory != NULL)? size: 0;
+    }
+
+    return arena->memory != NULL;
+}
+
+void* vn_arena_alloc (struct vn_arena *arena, size_t size)
+{
+    char *memory = arena->memory + arena->used;
+
+    arena->used += (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    return memory;
+}
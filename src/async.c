@@ -0,0 +1,438 @@
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "async.h"
+#include "private.h"
+
+/*
+ * Number of z planes (3D) or rows (2D) rendered between checks for
+ * cancellation. 3D slabs are as deep as tiles of value noise.
+ */
+#define SLAB_DEPTH 8
+#define SLAB_ROWS 16
+
+struct vn_async_request {
+    struct vn_async_pool *pool;
+    const struct vn_generator *generator;
+    struct vn_region region;
+    unsigned int *output;
+    unsigned int dimensions;
+    vn_request_callback callback;
+    void *data;
+
+    /* Protected by the pool lock */
+    int priority;
+    unsigned long sequence;
+    size_t heap_idx;
+    int finishing;
+
+    /* Can be read without the lock */
+    atomic_int state;
+    atomic_int cancelled;
+    atomic_int refcount;
+};
+
+struct vn_async_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+
+    /* Binary heap of pending requests, the most urgent first */
+    struct vn_async_request **heap;
+    size_t heap_size;
+    size_t heap_capacity;
+    size_t max_pending;
+
+    unsigned long sequence;
+    atomic_int stop;
+    /*
+     * One reference for vn_async_pool_destroy() and one for every
+     * request. The lock and the conditions stay valid while there are
+     * request handles which can wait on them.
+     */
+    atomic_int refcount;
+
+    pthread_t *threads;
+    unsigned int nthreads;
+};
+
+static void* worker (void *arg);
+
+/*----Priority queue--*/
+static int more_urgent (const struct vn_async_request *r1, const struct vn_async_request *r2)
+{
+    return (r1->priority != r2->priority)?
+        r1->priority > r2->priority:
+        r1->sequence < r2->sequence;
+}
+
+static void heap_set (struct vn_async_pool *pool, size_t idx, struct vn_async_request *request)
+{
+    pool->heap[idx] = request;
+    request->heap_idx = idx;
+}
+
+static void sift_up (struct vn_async_pool *pool, size_t idx)
+{
+    struct vn_async_request *request = pool->heap[idx];
+
+    while (idx > 0) {
+        size_t parent = (idx - 1) / 2;
+        if (!more_urgent (request, pool->heap[parent])) break;
+        heap_set (pool, idx, pool->heap[parent]);
+        idx = parent;
+    }
+
+    heap_set (pool, idx, request);
+}
+
+static void sift_down (struct vn_async_pool *pool, size_t idx)
+{
+    struct vn_async_request *request = pool->heap[idx];
+
+    while (1) {
+        size_t child = 2*idx + 1;
+        if (child >= pool->heap_size) break;
+        if (child + 1 < pool->heap_size &&
+            more_urgent (pool->heap[child + 1], pool->heap[child]))
+            child++;
+        if (!more_urgent (pool->heap[child], request)) break;
+        heap_set (pool, idx, pool->heap[child]);
+        idx = child;
+    }
+
+    heap_set (pool, idx, request);
+}
+
+static int heap_push (struct vn_async_pool *pool, struct vn_async_request *request)
+{
+    if (pool->heap_size == pool->heap_capacity) {
+        size_t capacity = (pool->heap_capacity != 0)? 2*pool->heap_capacity: 64;
+        struct vn_async_request **heap = realloc (pool->heap, capacity * sizeof (*heap));
+        if (heap == NULL) return 0;
+        pool->heap = heap;
+        pool->heap_capacity = capacity;
+    }
+
+    heap_set (pool, pool->heap_size, request);
+    sift_up (pool, pool->heap_size++);
+    return 1;
+}
+
+static void heap_remove (struct vn_async_pool *pool, size_t idx)
+{
+    struct vn_async_request *last = pool->heap[--pool->heap_size];
+
+    if (idx == pool->heap_size) return;
+    heap_set (pool, idx, last);
+    sift_up (pool, idx);
+    sift_down (pool, last->heap_idx);
+}
+/*--------------------*/
+
+static int is_finished (enum vn_request_state state)
+{
+    return state == VN_REQUEST_DONE || state == VN_REQUEST_CANCELLED;
+}
+
+static void unref_pool (struct vn_async_pool *pool)
+{
+    if (atomic_fetch_sub (&pool->refcount, 1) == 1) {
+        pthread_cond_destroy (&pool->done);
+        pthread_cond_destroy (&pool->work);
+        pthread_mutex_destroy (&pool->lock);
+        free (pool);
+    }
+}
+
+static void unref_request (struct vn_async_request *request)
+{
+    if (atomic_fetch_sub (&request->refcount, 1) == 1) {
+        unref_pool (request->pool);
+        free (request);
+    }
+}
+
+struct vn_async_pool* vn_async_pool (unsigned int threads, unsigned int max_pending)
+{
+    struct vn_async_pool *pool;
+    unsigned int i;
+
+    threads = (threads != 0)? threads: 1;
+
+    pool = calloc (1, sizeof (struct vn_async_pool));
+    if (pool == NULL) {
+        vn_errcode = NO_MEMORY;
+        return NULL;
+    }
+
+    pool->threads = malloc (threads * sizeof (pthread_t));
+    if (pool->threads == NULL) {
+        free (pool);
+        vn_errcode = NO_MEMORY;
+        return NULL;
+    }
+
+    pool->max_pending = max_pending;
+    pthread_mutex_init (&pool->lock, NULL);
+    pthread_cond_init (&pool->work, NULL);
+    pthread_cond_init (&pool->done, NULL);
+    atomic_init (&pool->stop, 0);
+    atomic_init (&pool->refcount, 1);
+
+    for (i=0; i<threads; i++) {
+        if (pthread_create (&pool->threads[i], NULL, worker, pool) != 0) {
+            pool->nthreads = i;
+            vn_async_pool_destroy (pool);
+            vn_errcode = THREAD_ERROR;
+            return NULL;
+        }
+    }
+    pool->nthreads = threads;
+
+    vn_errcode = ALL_OK;
+    return pool;
+}
+
+void vn_async_pool_destroy (struct vn_async_pool *pool)
+{
+    unsigned int i;
+
+    pthread_mutex_lock (&pool->lock);
+    atomic_store (&pool->stop, 1);
+    while (pool->heap_size != 0) {
+        struct vn_async_request *request = pool->heap[0];
+        heap_remove (pool, 0);
+        atomic_store (&request->state, VN_REQUEST_CANCELLED);
+        unref_request (request);
+    }
+    pthread_cond_broadcast (&pool->work);
+    pthread_cond_broadcast (&pool->done);
+    pthread_mutex_unlock (&pool->lock);
+
+    for (i=0; i<pool->nthreads; i++)
+        pthread_join (pool->threads[i], NULL);
+
+    free (pool->threads);
+    free (pool->heap);
+    pool->threads = NULL;
+    pool->heap = NULL;
+    unref_pool (pool);
+}
+
+static struct vn_async_request* submit (struct vn_async_pool *pool,
+                                        const struct vn_generator *generator,
+                                        const struct vn_region *region,
+                                        unsigned int *output, unsigned int dimensions,
+                                        int priority, vn_request_callback callback, void *data)
+{
+    struct vn_async_request *request = malloc (sizeof (struct vn_async_request));
+    if (request == NULL) {
+        vn_errcode = NO_MEMORY;
+        return NULL;
+    }
+
+    request->pool = pool;
+    request->generator = generator;
+    request->region = *region;
+    request->output = output;
+    request->dimensions = dimensions;
+    request->callback = callback;
+    request->data = data;
+    request->priority = priority;
+    request->finishing = 0;
+    atomic_init (&request->state, VN_REQUEST_PENDING);
+    atomic_init (&request->cancelled, 0);
+    /* One reference for the caller and one for the pool */
+    atomic_init (&request->refcount, 2);
+
+    pthread_mutex_lock (&pool->lock);
+    if (pool->max_pending != 0 && pool->heap_size >= pool->max_pending) {
+        pthread_mutex_unlock (&pool->lock);
+        free (request);
+        vn_errcode = QUEUE_FULL;
+        return NULL;
+    }
+
+    request->sequence = pool->sequence++;
+    if (!heap_push (pool, request)) {
+        pthread_mutex_unlock (&pool->lock);
+        free (request);
+        vn_errcode = NO_MEMORY;
+        return NULL;
+    }
+    atomic_fetch_add (&pool->refcount, 1);
+    pthread_cond_signal (&pool->work);
+    pthread_mutex_unlock (&pool->lock);
+
+    vn_errcode = ALL_OK;
+    return request;
+}
+
+struct vn_async_request* vn_async_submit_2d (struct vn_async_pool *pool,
+                                             const struct vn_generator *generator,
+                                             const struct vn_region *region,
+                                             unsigned int *output, int priority,
+                                             vn_request_callback callback, void *data)
+{
+    return submit (pool, generator, region, output, 2, priority, callback, data);
+}
+
+struct vn_async_request* vn_async_submit_3d (struct vn_async_pool *pool,
+                                             const struct vn_generator *generator,
+                                             const struct vn_region *region,
+                                             unsigned int *output, int priority,
+                                             vn_request_callback callback, void *data)
+{
+    return submit (pool, generator, region, output, 3, priority, callback, data);
+}
+
+enum vn_request_state vn_async_poll (const struct vn_async_request *request)
+{
+    return atomic_load (&request->state);
+}
+
+enum vn_request_state vn_async_wait (struct vn_async_request *request)
+{
+    enum vn_request_state state = atomic_load (&request->state);
+    struct vn_async_pool *pool = request->pool;
+
+    if (is_finished (state)) return state;
+
+    pthread_mutex_lock (&pool->lock);
+    while (!is_finished (state = atomic_load (&request->state)))
+        pthread_cond_wait (&pool->done, &pool->lock);
+    pthread_mutex_unlock (&pool->lock);
+
+    return state;
+}
+
+int vn_async_cancel (struct vn_async_request *request)
+{
+    enum vn_request_state state = atomic_load (&request->state);
+    struct vn_async_pool *pool = request->pool;
+    int res;
+
+    if (is_finished (state)) return state == VN_REQUEST_CANCELLED;
+
+    pthread_mutex_lock (&pool->lock);
+    state = atomic_load (&request->state);
+    /* A request which runs its callback will be done anyway */
+    res = state != VN_REQUEST_DONE && !request->finishing;
+    if (state == VN_REQUEST_PENDING) {
+        heap_remove (pool, request->heap_idx);
+        atomic_store (&request->state, VN_REQUEST_CANCELLED);
+        pthread_cond_broadcast (&pool->done);
+        /* Drop the reference of the pool. The caller still holds its own. */
+        unref_request (request);
+    } else if (state == VN_REQUEST_RUNNING && !request->finishing) {
+        /* The worker checks this flag under the lock before finishing */
+        atomic_store (&request->cancelled, 1);
+    }
+    pthread_mutex_unlock (&pool->lock);
+
+    return res;
+}
+
+int vn_async_reprioritize (struct vn_async_request *request, int priority)
+{
+    struct vn_async_pool *pool = request->pool;
+    int res = 0;
+
+    if (atomic_load (&request->state) != VN_REQUEST_PENDING) return 0;
+
+    pthread_mutex_lock (&pool->lock);
+    if (atomic_load (&request->state) == VN_REQUEST_PENDING) {
+        request->priority = priority;
+        sift_up (pool, request->heap_idx);
+        sift_down (pool, request->heap_idx);
+        res = 1;
+    }
+    pthread_mutex_unlock (&pool->lock);
+
+    return res;
+}
+
+void vn_async_release (struct vn_async_request *request)
+{
+    vn_async_cancel (request);
+    unref_request (request);
+}
+
+static int is_cancelled (const struct vn_async_request *request)
+{
+    return atomic_load_explicit (&request->cancelled, memory_order_relaxed) ||
+        atomic_load_explicit (&request->pool->stop, memory_order_relaxed);
+}
+
+static int render_request (struct vn_async_request *request)
+{
+    struct vn_region slab = request->region;
+    unsigned int *output = request->output;
+    unsigned int i, step;
+
+    if (request->dimensions == 2) {
+        size_t row = slab.width;
+        for (i=0; i<request->region.height; i+=step) {
+            if (is_cancelled (request)) return 0;
+            step = request->region.height - i;
+            step = (step < SLAB_ROWS)? step: SLAB_ROWS;
+            slab.y = request->region.y + i;
+            slab.height = step;
+            vn_render_2d (request->generator, &slab, output + row*i);
+        }
+    } else {
+        size_t plane = (size_t)slab.width * slab.height;
+        for (i=0; i<request->region.depth; i+=step) {
+            if (is_cancelled (request)) return 0;
+            step = request->region.depth - i;
+            step = (step < SLAB_DEPTH)? step: SLAB_DEPTH;
+            slab.z = request->region.z + i;
+            slab.depth = step;
+            vn_render_3d (request->generator, &slab, output + plane*i);
+        }
+    }
+
+    return 1;
+}
+
+static void* worker (void *arg)
+{
+    struct vn_async_pool *pool = arg;
+    struct vn_async_request *request;
+    int done;
+
+    pthread_mutex_lock (&pool->lock);
+    while (1) {
+        while (pool->heap_size == 0 && !atomic_load (&pool->stop))
+            pthread_cond_wait (&pool->work, &pool->lock);
+        if (atomic_load (&pool->stop)) break;
+
+        request = pool->heap[0];
+        heap_remove (pool, 0);
+        atomic_store (&request->state, VN_REQUEST_RUNNING);
+        pthread_mutex_unlock (&pool->lock);
+
+        done = render_request (request);
+
+        pthread_mutex_lock (&pool->lock);
+        done = done && !is_cancelled (request);
+        if (done && request->callback != NULL) {
+            /*
+             * The request cannot be cancelled from now on, but it is
+             * not done until the callback returns: waiters may free
+             * the callback data as soon as they see VN_REQUEST_DONE.
+             */
+            request->finishing = 1;
+            pthread_mutex_unlock (&pool->lock);
+            request->callback (request, request->data);
+            pthread_mutex_lock (&pool->lock);
+        }
+        atomic_store (&request->state, (done)? VN_REQUEST_DONE: VN_REQUEST_CANCELLED);
+        pthread_cond_broadcast (&pool->done);
+        unref_request (request);
+    }
+    pthread_mutex_unlock (&pool->lock);
+
+    return NULL;
+}
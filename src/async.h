@@ -0,0 +1,144 @@
+/**
+   @file async.h
+   @brief Asynchronous prioritized region requests.
+**/
+
+#ifndef __ASYNC_H__
+#define __ASYNC_H__
+
+#include "generic.h"
+#include "render.h"
+
+/**
+   \brief A pool of worker threads which serve region requests.
+**/
+struct vn_async_pool;
+
+/**
+   \brief A handle to a submitted region request.
+**/
+struct vn_async_request;
+
+/**
+   \brief State of a region request.
+**/
+enum vn_request_state {
+    VN_REQUEST_PENDING,   /**< Request waits in the queue. **/
+    VN_REQUEST_RUNNING,   /**< Request is being served by a worker. **/
+    VN_REQUEST_DONE,      /**< Output is completely filled. **/
+    VN_REQUEST_CANCELLED, /**< Request was cancelled, output is undefined. **/
+};
+
+/**
+   \brief Completion callback.
+
+   Called from a worker thread when the output of a request is
+   completely filled. It is not called for cancelled requests. The
+   request becomes `VN_REQUEST_DONE` only after the callback returns,
+   so `vn_async_wait()` returning `VN_REQUEST_DONE` means that the
+   callback has finished and its data may be freed. The callback must
+   not wait for its own request.
+**/
+typedef void (*vn_request_callback) (struct vn_async_request *request, void *data);
+
+/**
+   \brief Make a pool of worker threads.
+
+   Affects the error code.
+
+   \param threads Number of worker threads. Zero means one thread.
+   \param max_pending Maximal number of requests waiting in the
+          queue. Zero means no limit.
+   \return Created pool or `NULL` on error.
+**/
+struct vn_async_pool* vn_async_pool (unsigned int threads, unsigned int max_pending);
+
+/**
+   \brief Destroy a pool.
+
+   All pending requests are cancelled, running requests are cancelled
+   and waited for. Request handles stay valid until they are released
+   with `vn_async_release()`, and `vn_async_wait()` may be called on
+   them from other threads while the pool is being destroyed or after
+   that: the memory of the pool is freed only when the last request
+   handle is released.
+**/
+void vn_async_pool_destroy (struct vn_async_pool *pool);
+
+/**
+   \brief Submit a request for a 2D region.
+
+   Affects the error code. The generator and the output buffer must
+   stay valid until the request is done or cancelled. Requests with
+   bigger priority are served first, requests with equal priorities
+   are served in order of submission.
+
+   \param pool The pool.
+   \param generator Noise generator.
+   \param region The region (see `vn_render_2d()`).
+   \param output Buffer with room for `width * height` values.
+   \param priority Priority of the request.
+   \param callback Completion callback or `NULL`.
+   \param data Passed to the callback.
+   \return Request handle which must be released with
+           `vn_async_release()` or `NULL` on error.
+**/
+struct vn_async_request* vn_async_submit_2d (struct vn_async_pool *pool,
+                                             const struct vn_generator *generator,
+                                             const struct vn_region *region,
+                                             unsigned int *output, int priority,
+                                             vn_request_callback callback, void *data);
+
+/**
+   \brief Submit a request for a 3D region.
+
+   Like `vn_async_submit_2d()` but `output` is filled as with
+   `vn_render_3d()`.
+**/
+struct vn_async_request* vn_async_submit_3d (struct vn_async_pool *pool,
+                                             const struct vn_generator *generator,
+                                             const struct vn_region *region,
+                                             unsigned int *output, int priority,
+                                             vn_request_callback callback, void *data);
+
+/**
+   \brief Get the current state of a request without blocking.
+**/
+enum vn_request_state vn_async_poll (const struct vn_async_request *request);
+
+/**
+   \brief Wait until a request is done or cancelled.
+
+   If the request has a callback, it has returned by the time this
+   function returns `VN_REQUEST_DONE`.
+
+   \return `VN_REQUEST_DONE` or `VN_REQUEST_CANCELLED`.
+**/
+enum vn_request_state vn_async_wait (struct vn_async_request *request);
+
+/**
+   \brief Cancel a request.
+
+   A pending request is removed from the queue. A running request is
+   stopped at the next slice of its region.
+
+   \return Non-zero if the request will not be completed, zero if it
+           is already done or its callback is running.
+**/
+int vn_async_cancel (struct vn_async_request *request);
+
+/**
+   \brief Change priority of a pending request.
+   \return Non-zero on success, zero if the request is not pending
+           anymore.
+**/
+int vn_async_reprioritize (struct vn_async_request *request, int priority);
+
+/**
+   \brief Release a request handle.
+
+   A request which is still pending or running is cancelled.
+**/
+void vn_async_release (struct vn_async_request *request);
+
+#endif
@@ -1,13 +1,24 @@
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include "generic.h"
+#include "value.h"
+#include "worley.h"
 #include "private.h"
 
-enum vn_errcode vn_errcode;
+_Thread_local enum vn_errcode vn_errcode;
 const struct error_mapping {
     enum vn_errcode errcode;
     const char *errmsg;
 } error_mappings[] = {
     {ALL_OK, "No errors occured"},
+    {NO_MEMORY, "Cannot allocate memory"},
+    {QUEUE_FULL, "Request queue is full"},
+    {THREAD_ERROR, "Cannot create a thread"},
+    {INVALID_GENERATOR, "Operation is not supported by this generator"},
+    {BAD_DESCRIPTOR, "Malformed generator descriptor"},
+    {BAD_SHARD, "Invalid shard of a volume"},
+    {INVALID_PARAMETERS, "Generator parameters are out of range"},
     {0, NULL}
 };
 
@@ -28,6 +39,88 @@ const char* vn_get_error_msg ()
     return find_error_msg (vn_errcode);
 }
 
+static const char* const type_names[] = {
+    [VN_VALUE_NOISE]  = "value",
+    [VN_WORLEY_NOISE] = "worley",
+};
+
+void vn_generator_describe (const struct vn_generator *generator,
+                            struct vn_generator_desc *desc)
+{
+    generator->describe (generator, desc);
+}
+
+/*
+ * Descriptors come from other processes, so reject parameters which
+ * overflow shifts by octaves or grid size in the generators.
+ */
+static int desc_in_range (const struct vn_generator_desc *desc)
+{
+    switch (desc->type) {
+    case VN_VALUE_NOISE:
+        return desc->param != 0 && desc->param <= VN_MAX_OCTAVES && desc->grid_pow <= VN_MAX_OCTAVES;
+    case VN_WORLEY_NOISE:
+        return desc->grid_pow < 16;
+    }
+
+    return 0;
+}
+
+struct vn_generator* vn_generator_from_desc (const struct vn_generator_desc *desc)
+{
+    if (!desc_in_range (desc)) goto fail;
+
+    switch (desc->type) {
+    case VN_VALUE_NOISE:
+        return vn_value_generator_seeded (desc->param, desc->grid_pow, desc->seed);
+    case VN_WORLEY_NOISE:
+        return vn_worley_generator_seeded (desc->param, desc->grid_pow, desc->seed);
+    }
+
+fail:
+    vn_errcode = BAD_DESCRIPTOR;
+    return NULL;
+}
+
+int vn_desc_format (const struct vn_generator_desc *desc, char *buffer, size_t size)
+{
+    int len;
+
+    if ((unsigned int)desc->type >= sizeof (type_names) / sizeof (type_names[0]))
+        return 0;
+
+    len = snprintf (buffer, size, "%s:%u:%u:%u", type_names[desc->type],
+                    desc->param, desc->grid_pow, desc->seed);
+    return len >= 0 && (size_t)len < size;
+}
+
+int vn_desc_parse (const char *string, struct vn_generator_desc *desc)
+{
+    char name[16];
+    unsigned int i;
+    int len = -1;
+
+    /* %u silently accepts negative numbers */
+    if (strchr (string, '-') != NULL ||
+        sscanf (string, "%15[a-z]:%u:%u:%u%n", name, &desc->param,
+                &desc->grid_pow, &desc->seed, &len) != 4 ||
+        string[len] != '\0')
+        goto fail;
+
+    for (i=0; i<sizeof (type_names) / sizeof (type_names[0]); i++) {
+        if (strcmp (name, type_names[i]) == 0) {
+            desc->type = i;
+            if (!desc_in_range (desc)) goto fail;
+            vn_errcode = ALL_OK;
+            return 1;
+        }
+    }
+
+fail:
+    vn_errcode = BAD_DESCRIPTOR;
+    return 0;
+}
+
 void vn_destroy_generator (struct vn_generator *generator)
 {
     generator->destroy_generator (generator);
@@ -43,6 +136,19 @@ unsigned int vn_noise_2d (const struct vn_generator *generator, unsigned int x,
     return generator->noise_2d (generator, x, y);
 }
 
+unsigned int vn_noise_4d (const struct vn_generator *generator, unsigned int x, unsigned int y,
+                          unsigned int z, unsigned int t)
+{
+    return generator->noise_4d (generator, x, y, z, t);
+}
+
+void vn_noise_3d_gather (const struct vn_generator *generator, const unsigned int *x,
+                         const unsigned int *y, const unsigned int *z, size_t n,
+                         unsigned int *output)
+{
+    generator->noise_3d_batch (generator, x, y, z, n, output);
+}
+
 unsigned int vn_noise_3d (const struct vn_generator *generator, unsigned int x, unsigned int y, unsigned int z)
 {
     return generator->noise_3d (generator, x, y, z);
@@ -6,6 +6,8 @@
 #ifndef __GENERIC_H__
 #define __GENERIC_H__
 
+#include <stddef.h>
+
 /**
    \brief Noise generator structure.
 **/
@@ -16,12 +18,35 @@ struct vn_generator;
 **/
 void vn_destroy_generator (struct vn_generator *generator);
 
+/**
+   \brief Get a noise value at the point `(x, y, z, t)`.
+
+   Only value noise generators support 4D noise. Worley noise
+   generators return 0 and set the error code to `INVALID_GENERATOR`,
+   value noise generators do not affect the error code.
+**/
+unsigned int vn_noise_4d (const struct vn_generator *generator, unsigned int x,
+                          unsigned int y, unsigned int z, unsigned int t);
+
 /**
    \brief Get a noise value at the point `(x, y, z)`.
 **/
 unsigned int vn_noise_3d (const struct vn_generator *generator, unsigned int x,
                           unsigned int y, unsigned int z);
 
+/**
+   \brief Get noise values at `n` scattered points.
+
+   The point `i` is `(x[i], y[i], z[i])` and its noise value is stored
+   in `output[i]`. Points may come in any order. Value noise is
+   evaluated for blocks of points one octave at a time, which lets the
+   compiler vectorize the computation. This is much faster than
+   calling `vn_noise_3d()` for each point when there are many points.
+**/
+void vn_noise_3d_gather (const struct vn_generator *generator, const unsigned int *x,
+                         const unsigned int *y, const unsigned int *z, size_t n,
+                         unsigned int *output);
+
 /**
    \brief Get a noise value at the point `(x, y)`.
 **/
@@ -32,17 +57,96 @@ unsigned int vn_noise_2d (const struct vn_generator *generator, unsigned int x,
 **/
 unsigned int vn_noise_1d (const struct vn_generator *generator, unsigned int x);
 
+/**
+   \brief Types of noise generators.
+**/
+enum vn_generator_type {
+    VN_VALUE_NOISE,  /**< Made by `vn_value_generator_seeded()`. **/
+    VN_WORLEY_NOISE, /**< Made by `vn_worley_generator_seeded()`. **/
+};
+
+/**
+   \brief Description of a noise generator.
+
+   A generator made from a descriptor produces the same noise in any
+   process, so descriptors can be passed between processes to generate
+   parts of the same noise.
+**/
+struct vn_generator_desc {
+    enum vn_generator_type type; /**< Type of the generator. **/
+    unsigned int param;          /**< Number of octaves or dots. **/
+    unsigned int grid_pow;       /**< Grid size power. **/
+    unsigned int seed;           /**< Seed. **/
+};
+
+/**
+   \brief Maximal length of a formatted descriptor including the
+   terminating zero.
+**/
+#define VN_DESC_MAXLEN 64
+
+/**
+   \brief Get a descriptor of a generator.
+
+   Generators made by `vn_value_generator()` and
+   `vn_worley_generator()` get a seed from `rand()`, which is stored
+   in the descriptor.
+**/
+void vn_generator_describe (const struct vn_generator *generator,
+                            struct vn_generator_desc *desc);
+
+/**
+   \brief Make a generator from a descriptor.
+
+   Affects the error code. Descriptors of value noise with zero
+   octaves, with 31 or more octaves or with `grid_pow` of 31 or more,
+   and descriptors of worley noise with `grid_pow` of 16 or more are
+   rejected with `BAD_DESCRIPTOR`.
+
+   \return Created generator or `NULL` on error.
+**/
+struct vn_generator* vn_generator_from_desc (const struct vn_generator_desc *desc);
+
+/**
+   \brief Format a descriptor as a string.
+
+   The string has a form `type:param:grid_pow:seed`, e.g.
+   `value:5:8:12345`. `buffer` should have room for `VN_DESC_MAXLEN`
+   characters.
+
+   \return Zero if the string does not fit in the buffer.
+**/
+int vn_desc_format (const struct vn_generator_desc *desc, char *buffer, size_t size);
+
+/**
+   \brief Parse a descriptor formatted by `vn_desc_format()`.
+
+   Affects the error code. Negative numbers and parameters out of the
+   range accepted by `vn_generator_from_desc()` are rejected with
+   `BAD_DESCRIPTOR`.
+
+   \return Zero on error, non-zero otherwise.
+**/
+int vn_desc_parse (const char *string, struct vn_generator_desc *desc);
+
 /**
    \brief Error codes.
 **/
 enum vn_errcode {
-    ALL_OK, /**< No error. **/
+    ALL_OK,            /**< No error. **/
+    NO_MEMORY,         /**< Memory allocation failed. **/
+    QUEUE_FULL,        /**< Request queue is full. **/
+    THREAD_ERROR,      /**< Cannot create a thread. **/
+    INVALID_GENERATOR, /**< Generator of wrong type. **/
+    BAD_DESCRIPTOR,    /**< Malformed generator descriptor. **/
+    BAD_SHARD,         /**< Invalid shard of a volume. **/
+    INVALID_PARAMETERS, /**< Generator parameters are out of range. **/
 };
 
 /**
-   \brief Global error code.
+   \brief Error code of the last operation in the calling thread.
 **/
-extern enum vn_errcode vn_errcode;
+extern _Thread_local enum vn_errcode vn_errcode;
 
 /**
    \brief Get the last error code.
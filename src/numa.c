@@ -0,0 +1,101 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#include <pthread.h>
+#endif
+#include <stdio.h>
+#include "render.h"
+#include "private.h"
+
+/*
+ * NUMA topology is read from sysfs on Linux. On other systems everything
+ * is considered to be on one node and threads are not pinned.
+ */
+
+#ifdef __linux__
+/*
+ * Read a list like 0-7,16-23 from sysfs and mark its elements less than
+ * size in set. Returns the number of marked elements.
+ */
+static unsigned int read_list (const char *path, unsigned char *set, unsigned int size)
+{
+    FILE *file = fopen (path, "r");
+    unsigned int first, last, i, count = 0;
+    int c;
+
+    if (file == NULL) return 0;
+
+    while (fscanf (file, "%u", &first) == 1) {
+        last = first;
+        c = fgetc (file);
+        if (c == '-') {
+            if (fscanf (file, "%u", &last) != 1) break;
+            c = fgetc (file);
+        }
+        for (i=first; i<=last && i<size; i++) {
+            count += !set[i];
+            set[i] = 1;
+        }
+        if (c != ',') break;
+    }
+    fclose (file);
+
+    return count;
+}
+
+/*
+ * Ids of online nodes can have gaps (e.g. node0 and node2), so nodes
+ * are numbered by their position in the list of online nodes.
+ */
+static unsigned int online_nodes (unsigned int *ids)
+{
+    unsigned char set[VN_MAX_NUMA_NODES] = {0};
+    unsigned int i, nodes = 0;
+
+    read_list ("/sys/devices/system/node/online", set, VN_MAX_NUMA_NODES);
+    for (i=0; i<VN_MAX_NUMA_NODES; i++) {
+        if (set[i]) ids[nodes++] = i;
+    }
+
+    return nodes;
+}
+
+unsigned int vn_numa_nodes (void)
+{
+    unsigned int ids[VN_MAX_NUMA_NODES];
+    unsigned int nodes = online_nodes (ids);
+
+    return (nodes != 0)? nodes: 1;
+}
+
+int vn_numa_bind_thread (unsigned int node)
+{
+    unsigned int ids[VN_MAX_NUMA_NODES];
+    unsigned char cpus[CPU_SETSIZE] = {0};
+    char path[64];
+    unsigned int cpu;
+    cpu_set_t set;
+
+    if (node >= online_nodes (ids)) return 0;
+
+    snprintf (path, sizeof (path), "/sys/devices/system/node/node%u/cpulist", ids[node]);
+    if (read_list (path, cpus, CPU_SETSIZE) == 0) return 0;
+
+    CPU_ZERO (&set);
+    for (cpu=0; cpu<CPU_SETSIZE; cpu++) {
+        if (cpus[cpu]) CPU_SET (cpu, &set);
+    }
+
+    return pthread_setaffinity_np (pthread_self(), sizeof (set), &set) == 0;
+}
+#else
+unsigned int vn_numa_nodes (void)
+{
+    return 1;
+}
+
+int vn_numa_bind_thread (unsigned int node)
+{
+    return 0;
+}
+#endif
@@ -1,10 +1,60 @@
 #ifndef __PRIVATE_H__
 #define __PRIVATE_H__
 
+#include <stddef.h>
+#include "render.h"
+
 #define VN_GENERATOR_METHODS void (*destroy_generator) (struct vn_generator*); \
     unsigned int (*noise_1d) (const struct vn_generator*, unsigned int); \
     unsigned int (*noise_2d) (const struct vn_generator*, unsigned int, unsigned int); \
-    unsigned int (*noise_3d) (const struct vn_generator*, unsigned int, unsigned int, unsigned int);
+    unsigned int (*noise_3d) (const struct vn_generator*, unsigned int, unsigned int, unsigned int); \
+    unsigned int (*noise_4d) (const struct vn_generator*, unsigned int, unsigned int, unsigned int, unsigned int); \
+    void (*noise_3d_batch) (const struct vn_generator*, const unsigned int*, const unsigned int*, \
+                            const unsigned int*, size_t, unsigned int*); \
+    void (*describe) (const struct vn_generator*, struct vn_generator_desc*); \
+    void (*noise_2d_channels) (const struct vn_generator* const*, const unsigned int*, unsigned int, \
+                               unsigned int, unsigned int, unsigned int, unsigned int, unsigned int*); \
+    void (*render_3d) (const struct vn_generator*, const struct vn_region*, unsigned int*, \
+                       struct vn_stats*);
+
+/*
+ * render_3d (generator, region, output, stats) does the same as
+ * vn_render_3d() and adds the output to stats if it is not NULL.
+ */
+void vn_render_3d_points (const struct vn_generator *generator, const struct vn_region *region,
+                          unsigned int *output, struct vn_stats *stats);
+
+/*
+ * noise_2d_channels (generators, channels, ngenerators, nchannels, x, y, n, output)
+ * renders n points of a row starting at (x, y) for generators of the same
+ * type. Noise of generators[i] goes to output[k*nchannels + channels[i]]
+ * for the point k. n is not greater than VN_SPAN_SIZE.
+ */
+#define VN_SPAN_SIZE 64
+
+/*
+ * Per-thread scratch memory. vn_arena_reserve() discards everything
+ * allocated before and makes room for size bytes (allocations are aligned to
+ * 64 bytes, account for that), then vn_arena_alloc() takes pieces of it.
+ */
+struct vn_arena {
+    char *memory;
+    size_t capacity;
+    size_t used;
+};
+
+struct vn_arena* vn_thread_arena (void);
+int vn_arena_reserve (struct vn_arena *arena, size_t size);
+void* vn_arena_alloc (struct vn_arena *arena, size_t size);
+
+/* Number of online NUMA nodes, at least one */
+unsigned int vn_numa_nodes (void);
+
+/*
+ * Pin the calling thread to CPUs of a NUMA node. Nodes are numbered from
+ * zero in order of their ids. Returns zero on failure.
+ */
+int vn_numa_bind_thread (unsigned int node);
 
 struct vn_generator {
     VN_GENERATOR_METHODS
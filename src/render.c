@@ -0,0 +1,327 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "render.h"
+#include "private.h"
+
+void vn_render_2d (const struct vn_generator *generator, const struct vn_region *region,
+                   unsigned int *output)
+{
+    unsigned int i, j;
+
+    for (j=0; j<region->height; j++) {
+        for (i=0; i<region->width; i++)
+            *output++ = generator->noise_2d (generator, region->x + i, region->y + j);
+    }
+}
+
+void vn_render_3d_points (const struct vn_generator *generator, const struct vn_region *region,
+                          unsigned int *output, struct vn_stats *stats)
+{
+    unsigned int i, j, k;
+
+    for (k=0; k<region->depth; k++) {
+        for (j=0; j<region->height; j++) {
+            for (i=0; i<region->width; i++)
+                output[i] = generator->noise_3d (generator, region->x + i,
+                                                 region->y + j, region->z + k);
+            if (stats != NULL) vn_stats_add (stats, output, region->width);
+            output += region->width;
+        }
+    }
+}
+
+void vn_render_3d (const struct vn_generator *generator, const struct vn_region *region,
+                   unsigned int *output)
+{
+    generator->render_3d (generator, region, output, NULL);
+}
+
+int vn_render_2d_channels (const struct vn_generator * const *generators, unsigned int nchannels,
+                           const struct vn_region *region, unsigned int *output)
+{
+    const struct vn_generator **groups;
+    unsigned int *channels, *group_start;
+    unsigned int ngroups = 0;
+    unsigned int c, g, i, j, n;
+
+    vn_errcode = ALL_OK;
+    if (nchannels == 0) return 1;
+
+    /* Group channels by generator type, groups are stored contiguously */
+    groups = malloc (nchannels * sizeof (struct vn_generator*));
+    channels = malloc (nchannels * sizeof (unsigned int));
+    group_start = malloc ((nchannels + 1) * sizeof (unsigned int));
+    if (groups == NULL || channels == NULL || group_start == NULL) {
+        free (groups);
+        free (channels);
+        free (group_start);
+        vn_errcode = NO_MEMORY;
+        return 0;
+    }
+
+    for (c=0, i=0; c<nchannels; c++) {
+        for (g=0; g<c; g++) {
+            if (generators[g]->noise_2d_channels == generators[c]->noise_2d_channels) break;
+        }
+        if (g < c) continue;
+
+        group_start[ngroups++] = i;
+        for (g=c; g<nchannels; g++) {
+            if (generators[g]->noise_2d_channels == generators[c]->noise_2d_channels) {
+                groups[i] = generators[g];
+                channels[i] = g;
+                i++;
+            }
+        }
+    }
+    group_start[ngroups] = nchannels;
+
+    for (j=0; j<region->height; j++) {
+        for (i=0; i<region->width; i+=n) {
+            n = region->width - i;
+            n = (n < VN_SPAN_SIZE)? n: VN_SPAN_SIZE;
+            for (g=0; g<ngroups; g++) {
+                unsigned int start = group_start[g];
+                groups[start]->noise_2d_channels (groups + start, channels + start,
+                                                  group_start[g+1] - start, nchannels,
+                                                  region->x + i, region->y + j, n, output);
+            }
+            output += n * nchannels;
+        }
+    }
+
+    free (groups);
+    free (channels);
+    free (group_start);
+
+    return 1;
+}
+
+/*
+ * A job renders a slab of the region (a range of rows in 2D or a range of
+ * planes in 3D) and gathers statistics of each row while it is still in
+ * the cache.
+ */
+struct render_job {
+    const struct vn_generator *generator;
+    struct vn_region region;
+    unsigned int *output;
+    unsigned int dimensions;
+    struct vn_stats stats;
+    int gather_stats;
+    unsigned int flags;
+    unsigned int node;
+    double seconds;
+};
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t job_size (const struct render_job *job)
+{
+    size_t depth = (job->dimensions == 2)? 1: job->region.depth;
+    return (size_t)job->region.width * job->region.height * depth;
+}
+
+static void touch_pages (unsigned int *output, size_t n)
+{
+    size_t page = sysconf (_SC_PAGESIZE) / sizeof (unsigned int);
+    size_t i;
+
+    for (i=0; i<n; i+=page)
+        output[i] = 0;
+}
+
+static void* render_job (void *arg)
+{
+    struct render_job *job = arg;
+    struct vn_region row = job->region;
+    unsigned int *output = job->output;
+    struct vn_stats *stats = (job->gather_stats)? &job->stats: NULL;
+    unsigned int j;
+    double start;
+
+    if (job->flags & VN_RENDER_PIN_NUMA)
+        vn_numa_bind_thread (job->node);
+    if (job->flags & VN_RENDER_FIRST_TOUCH)
+        touch_pages (output, job_size (job));
+
+    start = now();
+    if (job->dimensions == 3) {
+        job->generator->render_3d (job->generator, &job->region, output, stats);
+    } else {
+        row.height = 1;
+        for (j=0; j<job->region.height; j++) {
+            row.y = job->region.y + j;
+            vn_render_2d (job->generator, &row, output);
+            if (stats != NULL) vn_stats_add (stats, output, row.width);
+            output += row.width;
+        }
+    }
+    job->seconds = now() - start;
+
+    return NULL;
+}
+
+static int render_parallel (const struct vn_generator *generator, const struct vn_region *region,
+                            unsigned int *output, unsigned int dimensions,
+                            const struct vn_render_options *options)
+{
+    struct render_job *jobs;
+    pthread_t *threads;
+    struct vn_stats *stats = options->stats;
+    unsigned int nthreads = (options->threads != 0)? options->threads: 1;
+    unsigned int slabs = (dimensions == 2)? region->height: region->depth;
+    size_t slab_size = (dimensions == 2)?
+        region->width: (size_t)region->width * region->height;
+    unsigned int nodes = 1, i, started, first, start = 0;
+    int res = 1;
+
+    nthreads = (nthreads < slabs)? nthreads: slabs;
+    nthreads = (nthreads != 0)? nthreads: 1;
+    if (options->flags & VN_RENDER_PIN_NUMA) nodes = vn_numa_nodes();
+
+    jobs = calloc (nthreads, sizeof (struct render_job));
+    threads = malloc (nthreads * sizeof (pthread_t));
+    if (jobs == NULL || threads == NULL) {
+        res = 0;
+        vn_errcode = NO_MEMORY;
+        goto cleanup;
+    }
+
+    for (i=0; i<nthreads; i++) {
+        unsigned int count = slabs / nthreads + ((i < slabs % nthreads)? 1: 0);
+        struct render_job *job = &jobs[i];
+
+        job->generator = generator;
+        job->region = *region;
+        job->output = output + slab_size * start;
+        job->dimensions = dimensions;
+        job->flags = options->flags;
+        /* Consecutive slabs go to the same node */
+        job->node = (unsigned long)i * nodes / nthreads;
+        if (dimensions == 2) {
+            job->region.y += start;
+            job->region.height = count;
+        } else {
+            job->region.z += start;
+            job->region.depth = count;
+        }
+        start += count;
+
+        if (stats != NULL) {
+            /* The first job gathers directly into the caller's statistics */
+            unsigned long long *histogram = (i == 0 || stats->nbins == 0)? stats->histogram:
+                malloc (sizeof (unsigned long long) * stats->nbins);
+            if (histogram == NULL && stats->nbins != 0) {
+                res = 0;
+                vn_errcode = NO_MEMORY;
+                goto cleanup;
+            }
+            if (i == 0) job->stats = *stats;
+            else vn_stats_init (&job->stats, histogram, stats->nbins);
+            job->gather_stats = 1;
+        }
+    }
+
+    /*
+     * The calling thread renders the first slab itself, unless threads are
+     * pinned: affinity of the caller must not change.
+     */
+    first = (options->flags & VN_RENDER_PIN_NUMA)? 0: 1;
+    for (started=first; started<nthreads; started++) {
+        if (pthread_create (&threads[started], NULL, render_job, &jobs[started]) != 0) {
+            res = 0;
+            vn_errcode = THREAD_ERROR;
+            break;
+        }
+    }
+    if (first != 0) render_job (&jobs[0]);
+    for (i=first; i<started; i++)
+        pthread_join (threads[i], NULL);
+
+    if (res && options->numa_stats != NULL) {
+        struct vn_numa_stats *numa = options->numa_stats;
+        memset (numa, 0, sizeof (struct vn_numa_stats));
+        for (i=0; i<nthreads; i++) {
+            unsigned int node = jobs[i].node;
+            numa->nodes = (node + 1 > numa->nodes)? node + 1: numa->nodes;
+            numa->threads[node]++;
+            numa->bytes[node] += job_size (&jobs[i]) * sizeof (unsigned int);
+            numa->seconds[node] = (jobs[i].seconds > numa->seconds[node])?
+                jobs[i].seconds: numa->seconds[node];
+        }
+    }
+
+    if (res && stats != NULL) {
+        *stats = jobs[0].stats;
+        for (i=1; i<nthreads; i++)
+            vn_stats_merge (stats, &jobs[i].stats);
+    }
+
+cleanup:
+    if (jobs != NULL && stats != NULL && stats->nbins != 0) {
+        for (i=1; i<nthreads; i++)
+            free (jobs[i].stats.histogram);
+    }
+    free (jobs);
+    free (threads);
+
+    if (res) vn_errcode = ALL_OK;
+    return res;
+}
+
+double vn_numa_throughput (const struct vn_numa_stats *stats, unsigned int node)
+{
+    return (stats->seconds[node] > 0)? stats->bytes[node] / stats->seconds[node]: 0;
+}
+
+int vn_render_2d_ex (const struct vn_generator *generator, const struct vn_region *region,
+                     unsigned int *output, const struct vn_render_options *options)
+{
+    return render_parallel (generator, region, output, 2, options);
+}
+
+int vn_render_3d_ex (const struct vn_generator *generator, const struct vn_region *region,
+                     unsigned int *output, const struct vn_render_options *options)
+{
+    return render_parallel (generator, region, output, 3, options);
+}
+
+int vn_shard_region (const struct vn_region *volume, unsigned int nshards, unsigned int index,
+                     struct vn_region *shard)
+{
+    unsigned int base, extra;
+
+    if (index >= nshards) {
+        vn_errcode = BAD_SHARD;
+        return 0;
+    }
+
+    base = volume->depth / nshards;
+    extra = volume->depth % nshards;
+
+    *shard = *volume;
+    shard->z = volume->z + base * index + ((index < extra)? index: extra);
+    shard->depth = base + ((index < extra)? 1: 0);
+
+    vn_errcode = ALL_OK;
+    return 1;
+}
+
+size_t vn_shard_offset (const struct vn_region *volume, const struct vn_region *shard)
+{
+    size_t x = shard->x - volume->x;
+    size_t y = shard->y - volume->y;
+    size_t z = shard->z - volume->z;
+
+    return (z * volume->height + y) * volume->width + x;
+}
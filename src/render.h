@@ -0,0 +1,187 @@
+/**
+   @file render.h
+   @brief Rendering of rectangular regions of noise.
+**/
+
+#ifndef __RENDER_H__
+#define __RENDER_H__
+
+#include "generic.h"
+#include "stats.h"
+
+/**
+   \brief A box of lattice points.
+
+   Region starts at the point `(x, y, z)` and spans `width` points
+   along x axis, `height` points along y axis and `depth` points along z
+   axis. For 2D regions `z` and `depth` are ignored.
+**/
+struct vn_region {
+    unsigned int x;      /**< Starting x coordinate. **/
+    unsigned int y;      /**< Starting y coordinate. **/
+    unsigned int z;      /**< Starting z coordinate. **/
+    unsigned int width;  /**< Number of points along x axis. **/
+    unsigned int height; /**< Number of points along y axis. **/
+    unsigned int depth;  /**< Number of points along z axis. **/
+};
+
+/**
+   \brief Fill `output` with 2D noise values from a region.
+
+   `output` must have room for `width * height` values. The value at
+   the point `(region->x + i, region->y + j)` is stored at index `j *
+   width + i`.
+**/
+void vn_render_2d (const struct vn_generator *generator, const struct vn_region *region,
+                   unsigned int *output);
+
+/**
+   \brief Fill `output` with 3D noise values from a region.
+
+   `output` must have room for `width * height * depth` values. The
+   value at the point `(region->x + i, region->y + j, region->z + k)`
+   is stored at index `(k * height + j) * width + i`.
+**/
+void vn_render_3d (const struct vn_generator *generator, const struct vn_region *region,
+                   unsigned int *output);
+
+/**
+   \brief Fill `output` with interleaved 2D noise from several generators.
+
+   The noise of `generators[c]` at the point `(region->x + i,
+   region->y + j)` is stored at index `(j * width + i) * nchannels +
+   c`. All channels are rendered in one traversal of the region, each
+   part of the output is written while it is in the cache, and
+   coordinate computations are shared between all channels with value
+   noise generators having the same grid size, whatever their order and
+   numbers of octaves are. This is faster than
+   rendering each channel separately and interleaving them.
+
+   Affects the error code.
+
+   \return Zero on error, non-zero otherwise.
+**/
+int vn_render_2d_channels (const struct vn_generator * const *generators, unsigned int nchannels,
+                           const struct vn_region *region, unsigned int *output);
+
+/**
+   \brief Maximal number of NUMA nodes in `struct vn_numa_stats`.
+**/
+#define VN_MAX_NUMA_NODES 16
+
+/**
+   \brief Per NUMA node statistics of rendering.
+
+   Without `VN_RENDER_PIN_NUMA` everything is accounted to node 0.
+   Nodes are indexed in order of online node ids, so with online
+   nodes 0 and 2 the node 2 has index 1.
+**/
+struct vn_numa_stats {
+    unsigned int nodes;                          /**< Number of used nodes. **/
+    unsigned int threads[VN_MAX_NUMA_NODES];     /**< Threads on each node. **/
+    unsigned long long bytes[VN_MAX_NUMA_NODES]; /**< Bytes written on each node. **/
+    double seconds[VN_MAX_NUMA_NODES];           /**< Time of the slowest thread on each node. **/
+};
+
+/**
+   \brief Get output throughput of a NUMA node in bytes per second.
+
+   This is the number of output bytes written by the threads of the
+   node divided by the time of its slowest thread. The time includes
+   computation of noise, so this is not memory bandwidth: it shows how
+   evenly the work is spread between nodes and how much remote memory
+   slows rendering down.
+**/
+double vn_numa_throughput (const struct vn_numa_stats *stats, unsigned int node);
+
+/**
+   \brief Distribute threads evenly between NUMA nodes and pin them to
+   CPUs of their nodes. Combined with memory from `vn_alloc_output()`,
+   each thread writes to memory of its own node.
+**/
+#define VN_RENDER_PIN_NUMA 1
+
+/**
+   \brief Each thread touches all pages of its part of the output before
+   rendering, so page faults are not mixed with the rendering and the
+   pages are allocated on the thread's node.
+**/
+#define VN_RENDER_FIRST_TOUCH 2
+
+/**
+   \brief Options for `vn_render_2d_ex()` and `vn_render_3d_ex()`.
+**/
+struct vn_render_options {
+    /**
+       Number of threads. Zero or one means rendering in the calling
+       thread.
+    **/
+    unsigned int threads;
+    /**
+       If not `NULL`, statistics of the rendered values are gathered
+       here while rendering. It must be initialized with
+       `vn_stats_init()`. Each thread gathers its own statistics which
+       are merged in the end.
+    **/
+    struct vn_stats *stats;
+    /**
+       Zero or a combination of `VN_RENDER_PIN_NUMA` and
+       `VN_RENDER_FIRST_TOUCH`.
+    **/
+    unsigned int flags;
+    /**
+       If not `NULL`, per node throughput is reported here.
+    **/
+    struct vn_numa_stats *numa_stats;
+};
+
+/**
+   \brief Like `vn_render_2d()`, but with options.
+
+   Affects the error code.
+
+   \return Zero on error, non-zero otherwise.
+**/
+int vn_render_2d_ex (const struct vn_generator *generator, const struct vn_region *region,
+                     unsigned int *output, const struct vn_render_options *options);
+
+/**
+   \brief Like `vn_render_3d()`, but with options.
+
+   Affects the error code.
+
+   \return Zero on error, non-zero otherwise.
+**/
+int vn_render_3d_ex (const struct vn_generator *generator, const struct vn_region *region,
+                     unsigned int *output, const struct vn_render_options *options);
+
+/**
+   \brief Get a shard of a volume.
+
+   The volume is split along z axis into `nshards` slabs of nearly
+   equal depth, the slab number `index` is stored in `shard`. Every
+   noise value depends only on its global coordinates and the
+   generator, so rendering each shard with any `vn_render_3d*()`
+   function from generators made from the same descriptor (see
+   `vn_generator_from_desc()`) gives exactly the same values as
+   rendering the whole volume, regardless of the number of shards or
+   threads. Shards occupy contiguous parts of the volume, starting at
+   the index returned by `vn_shard_offset()`. If `nshards` is bigger
+   than the depth of the volume, some shards are empty (have zero
+   depth).
+
+   Affects the error code.
+
+   \return Zero if `index` is not less than `nshards` (in particular
+           if `nshards` is zero), non-zero otherwise.
+**/
+int vn_shard_region (const struct vn_region *volume, unsigned int nshards, unsigned int index,
+                     struct vn_region *shard);
+
+/**
+   \brief Index of the first value of a box `shard` inside the output
+   for the whole `volume` (as filled by `vn_render_3d()`).
+**/
+size_t vn_shard_offset (const struct vn_region *volume, const struct vn_region *shard);
+
+#endif
@@ -0,0 +1,92 @@
+#include <limits.h>
+#include <string.h>
+#include "stats.h"
+
+void vn_stats_init (struct vn_stats *stats, unsigned long long *histogram, unsigned int nbins)
+{
+    stats->min = UINT_MAX;
+    stats->max = 0;
+    stats->count = 0;
+    stats->sum = 0;
+    stats->sum_squares = 0;
+    stats->nbins = (histogram != NULL)? nbins: 0;
+    stats->histogram = histogram;
+
+    if (stats->nbins != 0)
+        memset (histogram, 0, sizeof (unsigned long long) * nbins);
+}
+
+void vn_stats_add (struct vn_stats *stats, const unsigned int *values, size_t n)
+{
+    unsigned int min = stats->min;
+    unsigned int max = stats->max;
+    unsigned int nbins = stats->nbins;
+    unsigned long long *histogram = stats->histogram;
+    unsigned long sum = 0;
+    double sum_squares = 0;
+    size_t i;
+
+    for (i=0; i<n; i++) {
+        unsigned int v = values[i];
+        min = (v < min)? v: min;
+        max = (v > max)? v: max;
+        sum += v;
+        sum_squares += (double)v * v;
+    }
+
+    /* Separate loop, so the one above can be vectorized */
+    if (nbins != 0) {
+        for (i=0; i<n; i++)
+            histogram[((unsigned long long)values[i] * nbins) >> 32]++;
+    }
+
+    stats->min = min;
+    stats->max = max;
+    stats->count += n;
+    stats->sum += sum;
+    stats->sum_squares += sum_squares;
+}
+
+void vn_stats_merge (struct vn_stats *dst, const struct vn_stats *src)
+{
+    unsigned int i;
+
+    dst->min = (src->min < dst->min)? src->min: dst->min;
+    dst->max = (src->max > dst->max)? src->max: dst->max;
+    dst->count += src->count;
+    dst->sum += src->sum;
+    dst->sum_squares += src->sum_squares;
+
+    for (i=0; i<dst->nbins; i++)
+        dst->histogram[i] += src->histogram[i];
+}
+
+double vn_stats_mean (const struct vn_stats *stats)
+{
+    return (stats->count != 0)? stats->sum / stats->count: 0;
+}
+
+double vn_stats_variance (const struct vn_stats *stats)
+{
+    double mean = vn_stats_mean (stats);
+    return (stats->count != 0)? stats->sum_squares / stats->count - mean * mean: 0;
+}
+
+void vn_normalize (unsigned int *values, size_t n, const struct vn_stats *stats)
+{
+    unsigned int min = stats->min;
+    unsigned int range = stats->max - stats->min;
+    double scale;
+    size_t i;
+
+    if (stats->min >= stats->max) {
+        memset (values, 0, sizeof (unsigned int) * n);
+        return;
+    }
+
+    scale = (double)UINT_MAX / range;
+    for (i=0; i<n; i++) {
+        double v = (double)(values[i] - min) * scale + 0.5;
+        values[i] = (v < UINT_MAX)? v: UINT_MAX;
+    }
+}
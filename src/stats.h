@@ -0,0 +1,66 @@
+/**
+   @file stats.h
+   @brief Statistics of generated noise.
+**/
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stddef.h>
+
+/**
+   \brief Statistics of a set of noise values.
+
+   The histogram has `nbins` bins of equal width which cover the range
+   `[0; 2^32)`. The array for the histogram is supplied by the user.
+**/
+struct vn_stats {
+    unsigned int min;              /**< Minimal value. **/
+    unsigned int max;              /**< Maximal value. **/
+    unsigned long long count;      /**< Number of values. **/
+    double sum;                    /**< Sum of values. **/
+    double sum_squares;            /**< Sum of squared values. **/
+    unsigned int nbins;            /**< Number of histogram bins, can be zero. **/
+    unsigned long long *histogram; /**< Histogram or `NULL` if `nbins` is zero. **/
+};
+
+/**
+   \brief Initialize statistics with no values.
+
+   \param stats Statistics to initialize.
+   \param histogram An array of `nbins` elements or `NULL`.
+   \param nbins Number of histogram bins.
+**/
+void vn_stats_init (struct vn_stats *stats, unsigned long long *histogram, unsigned int nbins);
+
+/**
+   \brief Add `n` values to statistics.
+**/
+void vn_stats_add (struct vn_stats *stats, const unsigned int *values, size_t n);
+
+/**
+   \brief Merge statistics `src` into `dst`.
+
+   Both must have the same number of histogram bins.
+**/
+void vn_stats_merge (struct vn_stats *dst, const struct vn_stats *src);
+
+/**
+   \brief Mean of values.
+**/
+double vn_stats_mean (const struct vn_stats *stats);
+
+/**
+   \brief Variance of values.
+**/
+double vn_stats_variance (const struct vn_stats *stats);
+
+/**
+   \brief Stretch values in place to the full range.
+
+   Values are linearly mapped from `[stats->min; stats->max]` to
+   `[0; 2^32-1]`. Statistics are not modified.
+**/
+void vn_normalize (unsigned int *values, size_t n, const struct vn_stats *stats);
+
+#endif
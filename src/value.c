@@ -1,11 +1,13 @@
 #include <stdlib.h>
 #include <math.h>
 #include "value.h"
+#include "render.h"
 #include "private.h"
 
 struct vn_value_generator {
     VN_GENERATOR_METHODS
     unsigned int *seeds;
+    unsigned int seed;
     unsigned int octaves;
     unsigned int grid_pow;
 };
@@ -15,8 +17,26 @@ static unsigned int noise_3d (const struct vn_generator *gen,
                               unsigned int x, unsigned int y, unsigned int z);
 static unsigned int noise_2d (const struct vn_generator *gen, unsigned int x, unsigned int y);
 static unsigned int noise_1d (const struct vn_generator *gen, unsigned int x);
+static unsigned int noise_4d (const struct vn_generator *gen, unsigned int x,
+                              unsigned int y, unsigned int z, unsigned int t);
+static void noise_3d_batch (const struct vn_generator *gen, const unsigned int *x,
+                            const unsigned int *y, const unsigned int *z,
+                            size_t n, unsigned int *output);
+static void describe (const struct vn_generator *gen, struct vn_generator_desc *desc);
+static void noise_2d_channels (const struct vn_generator * const *gens, const unsigned int *channels,
+                               unsigned int ngens, unsigned int nchannels, unsigned int x,
+                               unsigned int y, unsigned int n, unsigned int *output);
+static void render_3d (const struct vn_generator *gen, const struct vn_region *region,
+                       unsigned int *output, struct vn_stats *stats);
+static unsigned int lolrand (unsigned int x, unsigned int y, unsigned int z, unsigned int seed);
 
 struct vn_generator* vn_value_generator (unsigned int octaves, unsigned int grid_pow)
+{
+    return vn_value_generator_seeded (octaves, grid_pow, rand());
+}
+
+struct vn_generator* vn_value_generator_seeded (unsigned int octaves, unsigned int grid_pow,
+                                                unsigned int seed)
 {
     struct vn_value_generator *generator;
     unsigned int i;
@@ -24,6 +44,15 @@ struct vn_generator* vn_value_generator (unsigned int octaves, unsigned int grid
     /* Sanity checks */
     grid_pow = (octaves > grid_pow)? octaves: grid_pow;
 
+    /*
+     * Octaves are summed with weights 2^k and per-octave state is kept in
+     * arrays of VN_MAX_OCTAVES elements.
+     */
+    if (octaves == 0 || octaves > VN_MAX_OCTAVES || grid_pow > VN_MAX_OCTAVES) {
+        vn_errcode = INVALID_PARAMETERS;
+        return NULL;
+    }
+
     vn_errcode = ALL_OK;
     generator = malloc (sizeof (struct vn_value_generator));
     generator->seeds = malloc (sizeof (unsigned int) * octaves);
@@ -33,14 +62,31 @@ struct vn_generator* vn_value_generator (unsigned int octaves, unsigned int grid
     generator->noise_1d = noise_1d;
     generator->noise_2d = noise_2d;
     generator->noise_3d = noise_3d;
-
+    generator->noise_4d = noise_4d;
+    generator->noise_3d_batch = noise_3d_batch;
+    generator->describe = describe;
+    generator->noise_2d_channels = noise_2d_channels;
+    generator->render_3d = render_3d;
+    generator->seed = seed;
+
+    /* Seeds of octaves depend only on the seed of the generator */
     for (i=0; i<octaves; i++)
-        generator->seeds[i] = rand();
+        generator->seeds[i] = lolrand (i, 0, 0, seed);
 
     return (struct vn_generator*)generator;
 }
 
 
+static void describe (const struct vn_generator *gen, struct vn_generator_desc *desc)
+{
+    const struct vn_value_generator *generator = (struct vn_value_generator*)gen;
+
+    desc->type = VN_VALUE_NOISE;
+    desc->param = generator->octaves;
+    desc->grid_pow = generator->grid_pow;
+    desc->seed = generator->seed;
+}
+
 static void destroy_generator (struct vn_generator *gen)
 {
     struct vn_value_generator *generator = (struct vn_value_generator*)gen;
@@ -92,63 +138,71 @@ static unsigned int lolrand (unsigned int x, unsigned int y, unsigned int z, uns
 
     return r;
 }
-/*--------------------*/
 
-static unsigned int value_noise_one_pass_3d (const struct vn_value_generator *generator, unsigned int x,
-                                             unsigned int y, unsigned int z, unsigned int pass)
+/*
+ * Lattice in 4D is a stack of 3D lattices along t axis. The 3D lattice at
+ * time index t is hashed as a 3D lattice with this seed, so the slice t = 0
+ * is the same as 3D noise.
+ */
+static unsigned int time_seed (unsigned int seed, unsigned int tidx)
 {
-    unsigned int v000, v001, v010, v011;
-    unsigned int v100, v101, v110, v111;
-    unsigned int v00, v01, v10, v11;
-    unsigned int v0, v1, v;
-
-    unsigned int diffx, diffy, diffz;
-    unsigned int intx, inty, intz;
-
-    unsigned int shift = generator->grid_pow - pass;
-    unsigned int mask = (1<<shift) - 1;
-
-    unsigned int xidx = x >> shift;
-    unsigned int yidx = y >> shift;
-    unsigned int zidx = z >> shift;
-
-    unsigned int seed = generator->seeds[pass];
+    return seed + tidx * 0x2C1B3C6D;
+}
+/*--------------------*/
 
+static void lattice_corners_3d (unsigned int xidx, unsigned int yidx, unsigned int zidx,
+                                unsigned int seed, unsigned int v[8])
+{
     /*
      * NB: Smart compilers like clang will partially apply lolrand function
      * (e.g. lolrandx = lolrand(x, _)) to reduce amount of calculations. Only
      * the last shift and multiplication by 0xCC9E2D51 will be calculated all
      * eight times.
      */
-    v000 = lolrand (xidx,   yidx,   zidx, seed);
-    v001 = lolrand (xidx+1, yidx,   zidx, seed);
-    v010 = lolrand (xidx,   yidx+1, zidx, seed);
-    v011 = lolrand (xidx+1, yidx+1, zidx, seed);
+    v[0] = lolrand (xidx,   yidx,   zidx, seed);
+    v[1] = lolrand (xidx+1, yidx,   zidx, seed);
+    v[2] = lolrand (xidx,   yidx+1, zidx, seed);
+    v[3] = lolrand (xidx+1, yidx+1, zidx, seed);
+
+    v[4] = lolrand (xidx,   yidx,   zidx+1, seed);
+    v[5] = lolrand (xidx+1, yidx,   zidx+1, seed);
+    v[6] = lolrand (xidx,   yidx+1, zidx+1, seed);
+    v[7] = lolrand (xidx+1, yidx+1, zidx+1, seed);
+}
 
-    v100 = lolrand (xidx,   yidx,   zidx+1, seed);
-    v101 = lolrand (xidx+1, yidx,   zidx+1, seed);
-    v110 = lolrand (xidx,   yidx+1, zidx+1, seed);
-    v111 = lolrand (xidx+1, yidx+1, zidx+1, seed);
+static unsigned int interpolate_cell_3d (const unsigned int v[8], unsigned int x,
+                                         unsigned int y, unsigned int z, unsigned int shift)
+{
+    unsigned int v00, v01, v10, v11;
+    unsigned int v0, v1;
 
-    diffx = x & mask;
-    diffy = y & mask;
-    diffz = z & mask;
+    unsigned int intx, inty, intz;
+    unsigned int mask = (1<<shift) - 1;
 
-    intx = intfn (diffx, shift);
-    inty = intfn (diffy, shift);
-    intz = intfn (diffz, shift);
+    intx = intfn (x & mask, shift);
+    inty = intfn (y & mask, shift);
+    intz = intfn (z & mask, shift);
 
-    v00 = interpolate (v000, v001, intx);
-    v01 = interpolate (v010, v011, intx);
-    v10 = interpolate (v100, v101, intx);
-    v11 = interpolate (v110, v111, intx);
+    v00 = interpolate (v[0], v[1], intx);
+    v01 = interpolate (v[2], v[3], intx);
+    v10 = interpolate (v[4], v[5], intx);
+    v11 = interpolate (v[6], v[7], intx);
 
     v0 = interpolate (v00, v01, inty);
     v1 = interpolate (v10, v11, inty);
 
-    v = interpolate (v0, v1, intz);
+    return interpolate (v0, v1, intz);
+}
 
-    return v;
+static unsigned int value_noise_one_pass_3d (const struct vn_value_generator *generator, unsigned int x,
+                                             unsigned int y, unsigned int z, unsigned int pass,
+                                             unsigned int seed)
+{
+    unsigned int v[8];
+    unsigned int shift = generator->grid_pow - pass;
+
+    lattice_corners_3d (x >> shift, y >> shift, z >> shift, seed, v);
+    return interpolate_cell_3d (v, x, y, z, shift);
 }
 
 static unsigned int noise_3d (const struct vn_generator *gen,
@@ -160,13 +214,212 @@ static unsigned int noise_3d (const struct vn_generator *gen,
     int shift = generator->octaves - 1;
 
     for (i=0; i<generator->octaves; i++) {
-        res += (long)(value_noise_one_pass_3d (generator, x, y, z, i)) << shift;
+        res += (long)(value_noise_one_pass_3d (generator, x, y, z, i, generator->seeds[i])) << shift;
         shift--;
     }
 
     return res / ((1<<generator->octaves) - 1);
 }
 
+/*
+ * Points are processed in blocks one octave at a time. The inner loop has
+ * no branches and no dependencies between points, so it can be vectorized.
+ */
+#define BATCH_SIZE 256
+
+static void noise_3d_batch (const struct vn_generator *gen, const unsigned int *x,
+                            const unsigned int *y, const unsigned int *z,
+                            size_t n, unsigned int *output)
+{
+    const struct vn_value_generator *generator = (struct vn_value_generator*)gen;
+    unsigned long acc[BATCH_SIZE];
+    unsigned int pass, octaves = generator->octaves;
+    size_t i, j, count;
+
+    for (j=0; j<n; j+=count) {
+        count = n - j;
+        count = (count < BATCH_SIZE)? count: BATCH_SIZE;
+
+        for (i=0; i<count; i++) acc[i] = 0;
+
+        for (pass=0; pass<octaves; pass++) {
+            unsigned int shift = generator->grid_pow - pass;
+            unsigned int seed = generator->seeds[pass];
+            unsigned int octave_shift = octaves - pass - 1;
+            const unsigned int *bx = x + j, *by = y + j, *bz = z + j;
+
+            for (i=0; i<count; i++) {
+                unsigned int v[8];
+                lattice_corners_3d (bx[i] >> shift, by[i] >> shift, bz[i] >> shift, seed, v);
+                acc[i] += (unsigned long)interpolate_cell_3d (v, bx[i], by[i], bz[i], shift)
+                    << octave_shift;
+            }
+        }
+
+        for (i=0; i<count; i++)
+            output[j+i] = acc[i] / ((1<<octaves) - 1);
+    }
+}
+
+/*
+ * Tiled rendering. For each octave the lattice covering a tile is hashed
+ * once into a slab, then the slab is interpolated along x, then along y,
+ * then along z. This gives the same results as interpolate_cell_3d(), but
+ * each interpolation is shared by all points which need it, so there are
+ * 1-2 interpolations per point instead of 7.
+ */
+#define TILE_WIDTH 64
+#define TILE_HEIGHT 8
+#define TILE_DEPTH 8
+
+/* Lattice cells of points of a tile along one axis */
+struct tile_axis {
+    unsigned int base;              /* The first lattice index */
+    unsigned int cells;             /* Number of lattice points (cells + 1) */
+    unsigned int cell[TILE_WIDTH];  /* Lattice index minus base for each point */
+    unsigned int weight[TILE_WIDTH];
+};
+
+static void make_tile_axis (struct tile_axis *axis, unsigned int start, unsigned int n,
+                            unsigned int shift)
+{
+    unsigned int mask = (1<<shift) - 1;
+    unsigned int i;
+
+    axis->base = start >> shift;
+    axis->cells = ((start + n - 1) >> shift) - axis->base + 2;
+    for (i=0; i<n; i++) {
+        axis->cell[i] = ((start + i) >> shift) - axis->base;
+        axis->weight[i] = intfn ((start + i) & mask, shift);
+    }
+}
+
+/* Size of scratch memory for one tile. The finest octave needs the most. */
+static size_t tile_scratch_size (const struct vn_value_generator *generator)
+{
+    unsigned int shift = generator->grid_pow - generator->octaves + 1;
+    size_t lx = ((TILE_WIDTH  - 1) >> shift) + 3;
+    size_t ly = ((TILE_HEIGHT - 1) >> shift) + 3;
+    size_t lz = ((TILE_DEPTH  - 1) >> shift) + 3;
+
+    return sizeof (unsigned long) * TILE_WIDTH * TILE_HEIGHT * TILE_DEPTH +
+        sizeof (unsigned int) * (lx * ly * lz + TILE_WIDTH * ly * lz +
+                                 TILE_WIDTH * TILE_HEIGHT * lz) + 256;
+}
+
+static void render_tile (const struct vn_value_generator *generator, struct vn_arena *arena,
+                         unsigned int x, unsigned int y, unsigned int z,
+                         unsigned int w, unsigned int h, unsigned int d,
+                         unsigned int *output, size_t row, size_t plane,
+                         struct vn_stats *stats)
+{
+    struct tile_axis ax, ay, az;
+    unsigned long *acc;
+    unsigned int *lattice, *xpass, *ypass;
+    unsigned int octaves = generator->octaves;
+    unsigned int pass, i, j, k, n = w*h*d;
+
+    arena->used = 0;
+    acc = vn_arena_alloc (arena, sizeof (unsigned long) * TILE_WIDTH * TILE_HEIGHT * TILE_DEPTH);
+    for (i=0; i<n; i++) acc[i] = 0;
+
+    for (pass=0; pass<octaves; pass++) {
+        unsigned int shift = generator->grid_pow - pass;
+        unsigned int seed = generator->seeds[pass];
+        unsigned int octave_shift = octaves - pass - 1;
+        unsigned int lx, ly, lz;
+        unsigned long *a = acc;
+        size_t mark = arena->used;
+
+        make_tile_axis (&ax, x, w, shift);
+        make_tile_axis (&ay, y, h, shift);
+        make_tile_axis (&az, z, d, shift);
+        lx = ax.cells; ly = ay.cells; lz = az.cells;
+
+        lattice = vn_arena_alloc (arena, sizeof (unsigned int) * lx * ly * lz);
+        xpass = vn_arena_alloc (arena, sizeof (unsigned int) * w * ly * lz);
+        ypass = vn_arena_alloc (arena, sizeof (unsigned int) * w * h * lz);
+
+        for (k=0; k<lz; k++) {
+            for (j=0; j<ly; j++) {
+                unsigned int *l = lattice + (k*ly + j)*lx;
+                for (i=0; i<lx; i++)
+                    l[i] = lolrand (ax.base + i, ay.base + j, az.base + k, seed);
+            }
+        }
+
+        for (k=0; k<lz*ly; k++) {
+            const unsigned int *l = lattice + k*lx;
+            unsigned int *xp = xpass + k*w;
+            for (i=0; i<w; i++)
+                xp[i] = interpolate (l[ax.cell[i]], l[ax.cell[i] + 1], ax.weight[i]);
+        }
+
+        for (k=0; k<lz; k++) {
+            for (j=0; j<h; j++) {
+                const unsigned int *xp0 = xpass + (k*ly + ay.cell[j])*w;
+                const unsigned int *xp1 = xp0 + w;
+                unsigned int *yp = ypass + (k*h + j)*w;
+                for (i=0; i<w; i++)
+                    yp[i] = interpolate (xp0[i], xp1[i], ay.weight[j]);
+            }
+        }
+
+        for (k=0; k<d; k++) {
+            for (j=0; j<h; j++) {
+                const unsigned int *yp0 = ypass + (az.cell[k]*h + j)*w;
+                const unsigned int *yp1 = yp0 + h*w;
+                for (i=0; i<w; i++)
+                    a[i] += (unsigned long)interpolate (yp0[i], yp1[i], az.weight[k]) << octave_shift;
+                a += w;
+            }
+        }
+
+        /* Scratch memory of this octave is not needed anymore */
+        arena->used = mark;
+    }
+
+    for (k=0; k<d; k++) {
+        for (j=0; j<h; j++) {
+            unsigned int *out = output + k*plane + j*row;
+            const unsigned long *a = acc + (k*h + j)*w;
+            for (i=0; i<w; i++)
+                out[i] = a[i] / ((1<<octaves) - 1);
+            if (stats != NULL) vn_stats_add (stats, out, w);
+        }
+    }
+}
+
+static void render_3d (const struct vn_generator *gen, const struct vn_region *region,
+                       unsigned int *output, struct vn_stats *stats)
+{
+    const struct vn_value_generator *generator = (struct vn_value_generator*)gen;
+    struct vn_arena *arena = vn_thread_arena();
+    size_t row = region->width;
+    size_t plane = row * region->height;
+    unsigned int i, j, k, w, h, d;
+
+    if (arena == NULL || !vn_arena_reserve (arena, tile_scratch_size (generator))) {
+        vn_render_3d_points (gen, region, output, stats);
+        return;
+    }
+
+    for (k=0; k<region->depth; k+=d) {
+        d = region->depth - k;
+        d = (d < TILE_DEPTH)? d: TILE_DEPTH;
+        for (j=0; j<region->height; j+=h) {
+            h = region->height - j;
+            h = (h < TILE_HEIGHT)? h: TILE_HEIGHT;
+            for (i=0; i<region->width; i+=w) {
+                w = region->width - i;
+                w = (w < TILE_WIDTH)? w: TILE_WIDTH;
+                render_tile (generator, arena, region->x + i, region->y + j, region->z + k,
+                             w, h, d, output + k*plane + j*row + i, row, plane, stats);
+            }
+        }
+    }
+}
+
 static unsigned int value_noise_one_pass_2d (const struct vn_value_generator *generator,
                                              unsigned int x, unsigned int y,
                                              unsigned int pass)
@@ -224,6 +477,104 @@ static unsigned int noise_2d (const struct vn_generator *gen, unsigned int x, un
     return res / ((1<<generator->octaves) - 1);
 }
 
+/*
+ * Lattice coordinates and interpolation weights of a span of a row. They
+ * depend only on grid_pow, and the plan for more octaves contains the
+ * plan for fewer, so one plan serves all channels with equal grid_pow.
+ */
+struct span_plan {
+    unsigned int yidx[VN_MAX_OCTAVES], inty[VN_MAX_OCTAVES];
+    unsigned int xidx[VN_MAX_OCTAVES][VN_SPAN_SIZE];
+    unsigned int intx[VN_MAX_OCTAVES][VN_SPAN_SIZE];
+};
+
+static void make_span_plan (struct span_plan *plan, unsigned int grid_pow, unsigned int octaves,
+                            unsigned int x, unsigned int y, unsigned int n)
+{
+    unsigned int pass, i;
+
+    for (pass=0; pass<octaves; pass++) {
+        unsigned int shift = grid_pow - pass;
+        unsigned int mask = (1<<shift) - 1;
+
+        plan->yidx[pass] = y >> shift;
+        plan->inty[pass] = intfn (y & mask, shift);
+        for (i=0; i<n; i++) {
+            plan->xidx[pass][i] = (x + i) >> shift;
+            plan->intx[pass][i] = intfn ((x + i) & mask, shift);
+        }
+    }
+}
+
+static void channel_from_plan (const struct vn_value_generator *generator, const struct span_plan *plan,
+                               unsigned int n, unsigned int stride, unsigned int *output)
+{
+    unsigned long acc[VN_SPAN_SIZE];
+    unsigned int octaves = generator->octaves;
+    unsigned int pass, i;
+
+    for (i=0; i<n; i++) acc[i] = 0;
+
+    for (pass=0; pass<octaves; pass++) {
+        unsigned int seed = generator->seeds[pass];
+        unsigned int yidx = plan->yidx[pass];
+        unsigned int inty = plan->inty[pass];
+        unsigned int octave_shift = octaves - pass - 1;
+
+        for (i=0; i<n; i++) {
+            unsigned int xidx = plan->xidx[pass][i];
+            unsigned int intx = plan->intx[pass][i];
+            unsigned int v0 = interpolate (lolrand (xidx,   yidx, 0, seed),
+                                           lolrand (xidx+1, yidx, 0, seed), intx);
+            unsigned int v1 = interpolate (lolrand (xidx,   yidx+1, 0, seed),
+                                           lolrand (xidx+1, yidx+1, 0, seed), intx);
+            acc[i] += (unsigned long)interpolate (v0, v1, inty) << octave_shift;
+        }
+    }
+
+    for (i=0; i<n; i++)
+        output[i*stride] = acc[i] / ((1<<octaves) - 1);
+}
+
+static void noise_2d_channels (const struct vn_generator * const *gens, const unsigned int *channels,
+                               unsigned int ngens, unsigned int nchannels, unsigned int x,
+                               unsigned int y, unsigned int n, unsigned int *output)
+{
+    struct span_plan plan;
+    const struct vn_value_generator *generator;
+    unsigned int grid_pow, octaves, next, g;
+    int found;
+
+    /*
+     * Visit generators in order of increasing grid_pow, whatever the
+     * order of channels is. Each grid_pow gets one plan for the biggest
+     * number of octaves among its generators.
+     */
+    for (next = 0; ; next = grid_pow + 1) {
+        found = 0;
+        grid_pow = octaves = 0;
+        for (g=0; g<ngens; g++) {
+            generator = (struct vn_value_generator*)gens[g];
+            if (generator->grid_pow < next) continue;
+            if (!found || generator->grid_pow < grid_pow) {
+                grid_pow = generator->grid_pow;
+                octaves = 0;
+                found = 1;
+            }
+            if (generator->grid_pow == grid_pow && generator->octaves > octaves)
+                octaves = generator->octaves;
+        }
+        if (!found) break;
+
+        make_span_plan (&plan, grid_pow, octaves, x, y, n);
+        for (g=0; g<ngens; g++) {
+            generator = (struct vn_value_generator*)gens[g];
+            if (generator->grid_pow == grid_pow)
+                channel_from_plan (generator, &plan, n, nchannels, output + channels[g]);
+        }
+    }
+}
+
 static unsigned int value_noise_one_pass_1d (const struct vn_value_generator *generator,
                                              unsigned int x, unsigned int pass)
 {
@@ -267,3 +618,189 @@ static unsigned int noise_1d (const struct vn_generator *gen, unsigned int x)
 
     return res / ((1<<generator->octaves) - 1);
 }
+
+static unsigned int value_noise_one_pass_4d (const struct vn_value_generator *generator,
+                                             unsigned int x, unsigned int y,
+                                             unsigned int z, unsigned int t,
+                                             unsigned int pass)
+{
+    unsigned int v0, v1;
+
+    unsigned int shift = generator->grid_pow - pass;
+    unsigned int mask = (1<<shift) - 1;
+    unsigned int tidx = t >> shift;
+
+    unsigned int seed = generator->seeds[pass];
+
+    v0 = value_noise_one_pass_3d (generator, x, y, z, pass, time_seed (seed, tidx));
+    v1 = value_noise_one_pass_3d (generator, x, y, z, pass, time_seed (seed, tidx+1));
+
+    return interpolate (v0, v1, intfn (t & mask, shift));
+}
+
+static unsigned int noise_4d (const struct vn_generator *gen, unsigned int x,
+                              unsigned int y, unsigned int z, unsigned int t)
+{
+    const struct vn_value_generator *generator = (struct vn_value_generator*)gen;
+
+    unsigned long i, res = 0;
+    int shift = generator->octaves - 1;
+
+    for (i=0; i<generator->octaves; i++) {
+        res += (long)(value_noise_one_pass_4d (generator, x, y, z, t, i)) << shift;
+        shift--;
+    }
+
+    return res / ((1<<generator->octaves) - 1);
+}
+
+/*
+ * For each octave the animation keeps two 3D slices of the region at
+ * neighbouring time lattice indices. While t stays in the same cell of
+ * the time lattice only the interpolation along t is recalculated.
+ */
+struct vn_value_animation {
+    const struct vn_value_generator *generator;
+    struct vn_region region;
+    size_t npoints;
+    unsigned int *storage;
+    unsigned int **lower;
+    unsigned int **upper;
+    unsigned int *tidx;
+    int valid;
+};
+
+struct vn_value_animation* vn_value_animation (const struct vn_generator *gen,
+                                               const struct vn_region *region)
+{
+    const struct vn_value_generator *generator = (struct vn_value_generator*)gen;
+    struct vn_value_animation *animation;
+    unsigned int i, octaves;
+
+    if (gen->noise_3d != noise_3d) {
+        vn_errcode = INVALID_GENERATOR;
+        return NULL;
+    }
+
+    /* Frames keep interpolation weights of octaves on the stack */
+    octaves = generator->octaves;
+    if (octaves == 0 || octaves > VN_MAX_OCTAVES) {
+        vn_errcode = INVALID_PARAMETERS;
+        return NULL;
+    }
+
+    animation = malloc (sizeof (struct vn_value_animation));
+    if (animation == NULL) {
+        vn_errcode = NO_MEMORY;
+        return NULL;
+    }
+
+    animation->generator = generator;
+    animation->region = *region;
+    animation->npoints = (size_t)region->width * region->height * region->depth;
+    animation->valid = 0;
+    animation->storage = malloc (sizeof (unsigned int) * 2 * octaves * animation->npoints);
+    animation->lower = malloc (sizeof (unsigned int*) * octaves);
+    animation->upper = malloc (sizeof (unsigned int*) * octaves);
+    animation->tidx = malloc (sizeof (unsigned int) * octaves);
+
+    if (animation->storage == NULL || animation->lower == NULL ||
+        animation->upper == NULL || animation->tidx == NULL) {
+        vn_value_animation_destroy (animation);
+        vn_errcode = NO_MEMORY;
+        return NULL;
+    }
+
+    for (i=0; i<octaves; i++) {
+        animation->lower[i] = animation->storage + (2*i) * animation->npoints;
+        animation->upper[i] = animation->storage + (2*i+1) * animation->npoints;
+    }
+
+    vn_errcode = ALL_OK;
+    return animation;
+}
+
+void vn_value_animation_destroy (struct vn_value_animation *animation)
+{
+    free (animation->storage);
+    free (animation->lower);
+    free (animation->upper);
+    free (animation->tidx);
+    free (animation);
+}
+
+static void fill_slice (const struct vn_value_animation *animation, unsigned int *slice,
+                        unsigned int pass, unsigned int tidx)
+{
+    const struct vn_value_generator *generator = animation->generator;
+    const struct vn_region *region = &animation->region;
+    unsigned int seed = time_seed (generator->seeds[pass], tidx);
+    unsigned int i, j, k;
+
+    for (k=0; k<region->depth; k++) {
+        for (j=0; j<region->height; j++) {
+            for (i=0; i<region->width; i++)
+                *slice++ = value_noise_one_pass_3d (generator, region->x + i, region->y + j,
+                                                    region->z + k, pass, seed);
+        }
+    }
+}
+
+static void update_slices (struct vn_value_animation *animation, unsigned int pass,
+                           unsigned int tidx)
+{
+    unsigned int *tmp;
+    unsigned int old = animation->tidx[pass];
+
+    if (animation->valid && tidx == old) return;
+
+    if (animation->valid && tidx == old + 1) {
+        /* Moved forward by one cell: the upper slice becomes the lower one */
+        tmp = animation->lower[pass];
+        animation->lower[pass] = animation->upper[pass];
+        animation->upper[pass] = tmp;
+        fill_slice (animation, animation->upper[pass], pass, tidx + 1);
+    } else if (animation->valid && tidx + 1 == old) {
+        tmp = animation->upper[pass];
+        animation->upper[pass] = animation->lower[pass];
+        animation->lower[pass] = tmp;
+        fill_slice (animation, animation->lower[pass], pass, tidx);
+    } else {
+        fill_slice (animation, animation->lower[pass], pass, tidx);
+        fill_slice (animation, animation->upper[pass], pass, tidx + 1);
+    }
+
+    animation->tidx[pass] = tidx;
+}
+
+void vn_value_animation_frame (struct vn_value_animation *animation, unsigned int t,
+                               unsigned int *output)
+{
+    const struct vn_value_generator *generator = animation->generator;
+    unsigned int octaves = generator->octaves;
+    unsigned int intt[VN_MAX_OCTAVES];
+    unsigned int pass;
+    size_t i;
+
+    for (pass=0; pass<octaves; pass++) {
+        unsigned int shift = generator->grid_pow - pass;
+        unsigned int mask = (1<<shift) - 1;
+        update_slices (animation, pass, t >> shift);
+        intt[pass] = intfn (t & mask, shift);
+    }
+    animation->valid = 1;
+
+    for (i=0; i<animation->npoints; i++) {
+        unsigned long res = 0;
+        int shift = octaves - 1;
+
+        for (pass=0; pass<octaves; pass++) {
+            unsigned int v = interpolate (animation->lower[pass][i],
+                                          animation->upper[pass][i], intt[pass]);
+            res += (long)v << shift;
+            shift--;
+        }
+
+        output[i] = res / ((1<<octaves) - 1);
+    }
+}
@@ -8,21 +8,79 @@
 
 #include <limits.h>
 #include "generic.h"
+#include "render.h"
+
+/**
+   \brief Maximal number of octaves and grid size power of value noise.
+**/
+#define VN_MAX_OCTAVES 30
 
 /**
    \brief Make a value noise generator.
 
-   Affects the error code setting it to `ALL_OK`. Returned noise is in
-   the range `[0; 2^32)`. Grid size is converted to `max (octaves,
-   grid_pow)`, i.e. grid size power cannot be less than number of
-   octaves.
+   Affects the error code. Returned noise is in the range `[0;
+   2^32)`. Grid size is converted to `max (octaves, grid_pow)`,
+   i.e. grid size power cannot be less than number of octaves.
 
    \param octaves Number of high frequency components in the
-          output.
+          output, from 1 to `VN_MAX_OCTAVES`.
    \param grid_pow Initial grid size is `2^grid_pow`. Actual grid_pow is
-          `max (octaves, grid_pow)`.
-   \return Created generator.
+          `max (octaves, grid_pow)` and cannot exceed `VN_MAX_OCTAVES`.
+   \return Created generator or `NULL` with the error code
+           `INVALID_PARAMETERS` if the parameters are out of range.
 **/
 struct vn_generator* vn_value_generator (unsigned int octaves, unsigned int grid_pow);
 
+/**
+   \brief Make a value noise generator with a given seed.
+
+   Like `vn_value_generator()`, but the noise depends only on the
+   arguments, so generators made with the same arguments produce the
+   same noise in any process.
+**/
+struct vn_generator* vn_value_generator_seeded (unsigned int octaves, unsigned int grid_pow,
+                                                unsigned int seed);
+
+/**
+   \brief Sequence of frames of animated value noise.
+**/
+struct vn_value_animation;
+
+/**
+   \brief Make a sequence of frames of 4D value noise.
+
+   Each frame is a 3D region of 4D value noise at some moment of time
+   `t` (use `depth = 1` for 2D frames). For each octave the animation
+   keeps two slices of the region at the bounds of the current cell of
+   time lattice, so consecutive frames inside the same cell are
+   obtained by interpolation along t only. The lattice is hashed again
+   only when t crosses a cell boundary. This needs `2 * octaves` values
+   of memory per point of the region.
+
+   Affects the error code. Generators of other types are rejected with
+   `INVALID_GENERATOR`, generators with more than `VN_MAX_OCTAVES`
+   octaves with `INVALID_PARAMETERS`.
+
+   \param generator Value noise generator.
+   \param region The region (see `vn_render_3d()`).
+   \return Created animation or `NULL` on error.
+**/
+struct vn_value_animation* vn_value_animation (const struct vn_generator *generator,
+                                               const struct vn_region *region);
+
+/**
+   \brief Render a frame at the moment `t`.
+
+   `output` is filled as with `vn_render_3d()` with values equal to
+   `vn_noise_4d (generator, x, y, z, t)`. Frames are cheapest when t
+   grows (or decreases) monotonically.
+**/
+void vn_value_animation_frame (struct vn_value_animation *animation, unsigned int t,
+                               unsigned int *output);
+
+/**
+   \brief Destroy an animation.
+**/
+void vn_value_animation_destroy (struct vn_value_animation *animation);
+
 #endif
@@ -9,5 +9,9 @@
 #include "generic.h"
 #include "value.h"
 #include "worley.h"
+#include "render.h"
+#include "stats.h"
+#include "alloc.h"
+#include "async.h"
 
 #endif
@@ -11,6 +11,7 @@
 
 struct vn_worley_generator {
     VN_GENERATOR_METHODS
+    unsigned int dots;
     unsigned int dots_mask;
     unsigned int seed;
     unsigned int grid_pow;
@@ -37,18 +38,39 @@ static void destroy_generator (struct vn_generator *gen);
 static unsigned int noise_1d (const struct vn_generator *gen, unsigned int x);
 static unsigned int noise_2d (const struct vn_generator *gen, unsigned int x, unsigned int y);
 static unsigned int noise_3d (const struct vn_generator *gen, unsigned int x, unsigned int y, unsigned int z);
+static unsigned int noise_4d (const struct vn_generator *gen, unsigned int x, unsigned int y,
+                              unsigned int z, unsigned int t);
+static void noise_3d_batch (const struct vn_generator *gen, const unsigned int *x,
+                            const unsigned int *y, const unsigned int *z,
+                            size_t n, unsigned int *output);
+static void describe (const struct vn_generator *gen, struct vn_generator_desc *desc);
+static void noise_2d_channels (const struct vn_generator * const *gens, const unsigned int *channels,
+                               unsigned int ngens, unsigned int nchannels, unsigned int x,
+                               unsigned int y, unsigned int n, unsigned int *output);
 
 struct vn_generator* vn_worley_generator (unsigned int dots, unsigned int grid_pow)
+{
+    return vn_worley_generator_seeded (dots, grid_pow, rand());
+}
+
+struct vn_generator* vn_worley_generator_seeded (unsigned int dots, unsigned int grid_pow,
+                                                 unsigned int seed)
 {
     struct vn_worley_generator *generator = malloc (sizeof (struct vn_worley_generator));
     generator->grid_pow = grid_pow;
-    generator->seed = rand();
+    generator->seed = seed;
     generator->destroy_generator = destroy_generator;
     generator->noise_1d = noise_1d;
     generator->noise_2d = noise_2d;
     generator->noise_3d = noise_3d;
+    generator->noise_4d = noise_4d;
+    generator->noise_3d_batch = noise_3d_batch;
+    generator->describe = describe;
+    generator->noise_2d_channels = noise_2d_channels;
+    generator->render_3d = vn_render_3d_points;
 
     dots = (dots <= 4)? dots: 4;
+    generator->dots = dots;
     unsigned int squared = 1 << (grid_pow << 1);
     generator->scale_2d = (float)UINT_MAX / ((float)squared * max_2d[dots]);
     generator->scale_3d = (float)UINT_MAX / ((float)squared * max_3d[dots]);
@@ -59,6 +81,16 @@ struct vn_generator* vn_worley_generator (unsigned int dots, unsigned int grid_p
     return (struct vn_generator*)generator;
 }
 
+static void describe (const struct vn_generator *gen, struct vn_generator_desc *desc)
+{
+    const struct vn_worley_generator *generator = (struct vn_worley_generator*)gen;
+
+    desc->type = VN_WORLEY_NOISE;
+    desc->param = generator->dots;
+    desc->grid_pow = generator->grid_pow;
+    desc->seed = generator->seed;
+}
+
 static void destroy_generator (struct vn_generator *gen)
 {
     free (gen);
@@ -170,6 +202,18 @@ static unsigned int noise_2d (const struct vn_generator *gen, unsigned int x, un
     return res;
 }
 
+static void noise_2d_channels (const struct vn_generator * const *gens, const unsigned int *channels,
+                               unsigned int ngens, unsigned int nchannels, unsigned int x,
+                               unsigned int y, unsigned int n, unsigned int *output)
+{
+    unsigned int g, i;
+
+    for (g=0; g<ngens; g++) {
+        for (i=0; i<n; i++)
+            output[i*nchannels + channels[g]] = noise_2d (gens[g], x + i, y);
+    }
+}
+
 static unsigned int check_cube (const struct vn_worley_generator *generator,
                                 int sx, int sy, int sz,
                                 int dx, int dy, int dz)
@@ -281,8 +325,25 @@ static unsigned int noise_3d (const struct vn_generator *gen, unsigned int x, un
     return res;
 }
 
+static void noise_3d_batch (const struct vn_generator *gen, const unsigned int *x,
+                            const unsigned int *y, const unsigned int *z,
+                            size_t n, unsigned int *output)
+{
+    size_t i;
+
+    for (i=0; i<n; i++)
+        output[i] = noise_3d (gen, x[i], y[i], z[i]);
+}
+
 static unsigned int noise_1d (const struct vn_generator *gen, unsigned int x)
 {
     // FIXME: This is of no interest and returns 0;
     return 0;
 }
+
+static unsigned int noise_4d (const struct vn_generator *gen, unsigned int x, unsigned int y,
+                              unsigned int z, unsigned int t)
+{
+    vn_errcode = INVALID_GENERATOR;
+    return 0;
+}
@@ -21,4 +21,14 @@
    \return Created generator.
 **/
 struct vn_generator* vn_worley_generator (unsigned int dots, unsigned int grid_pow);
+
+/**
+   \brief Make worley noise generator with a given seed.
+
+   Like `vn_worley_generator()`, but the noise depends only on the
+   arguments, so generators made with the same arguments produce the
+   same noise in any process.
+**/
+struct vn_generator* vn_worley_generator_seeded (unsigned int dots, unsigned int grid_pow,
+                                                 unsigned int seed);
 #endif